@@ -1,387 +1,590 @@
-#include "linked_list.h"  // Inkluderar header-filen som definierar strukturen och funktionerna för den länkade listan.
-#include "memory_manager.h" // Inkluderar minneshanterarens funktioner som används för allokering och frigöring av minne.
-
-
-void list_init(Node** head, size_t size) {
-    mem_init(size); // Initierar minneshanteraren med den specificerade storleken.
-    *head = NULL;  // Sätter listans huvudpekare till NULL (vilket betyder att listan är tom).
-}
-
-// Funktion för att lägga till en ny nod i slutet av listan.
-void list_insert(Node** head, uint16_t data) {
-    Node* new_node = (Node*)mem_alloc(sizeof(Node)); // Allokerar minne för en ny nod.
-    if (new_node == NULL) {
-        printf("Memory allocation failed.\n"); // Kontrollerar om minnesallokeringen misslyckades och skriver ett felmeddelande.
-        return;  // Avslutar funktionen om allokeringen misslyckades.
-    }
-    new_node->data = data;  // Sätter datavärdet för den nya noden.
-    new_node->next = NULL; // Noden pekar initialt på NULL (inget efterföljande element).
-
-    if (*head == NULL) {
-        *head = new_node; // Om listan är tom, sätts den nya noden som listans huvud.
-    } else {
-        Node* temp = *head;
-        while (temp->next != NULL) {
-            temp = temp->next; // Går till sista noden i listan.
-        }
-        temp->next = new_node; // Lägger till den nya noden i slutet av listan.
-    }
-}
-
-// Funktion för att lägga till en nod efter en given nod.
-void list_insert_after(Node* prev_node, uint16_t data) {
-    if (prev_node == NULL) {
-        printf("Previous node cannot be NULL.\n"); // Kontrollerar om föregående nod är NULL och skriver ett felmeddelande.
-        return;
-    }
-    Node* new_node = (Node*)mem_alloc(sizeof(Node)); // Allokerar minne för den nya noden.
-    if (new_node == NULL) {
-        printf("Memory allocation failed.\n"); // Kontroll om minnesallokeringen misslyckas.
-        return;
-    }
-    new_node->data = data;
-    new_node->next = prev_node->next; // Sätter den nya nodens nästa pekare till föregående nods nästa nod.
-    prev_node->next = new_node; // Uppdaterar föregående nod så att den pekar på den nya noden.
-}
-
-// Funktion för att lägga till en nod innan en given nod.
-void list_insert_before(Node** head, Node* next_node, uint16_t data) {
-    if (*head == NULL || next_node == NULL) { 
-        printf("Cannot insert before NULL node.\n"); // Kontroll om listan är tom eller om nästa nod är NULL.
-        return;
-    }
-
-    Node* new_node = (Node*)mem_alloc(sizeof(Node));  // Allokerar minne för den nya noden.
-    if (new_node == NULL) {
-        printf("Memory allocation failed.\n"); // Kontroll om minnesallokeringen misslyckas.
-        return;
-    }
-    new_node->data = data;
-
-    if (*head == next_node) { // Kontroll om nästa nod är huvudnoden i listan.
-        new_node->next = *head;  // Sätter den nya nodens nästa pekare till huvudnoden.
-        *head = new_node;   // Gör den nya noden till listans nya huvud.
-    } else {
-        Node* temp = *head;
-        while (temp != NULL && temp->next != next_node) {
-            temp = temp->next; // Loopar igenom listan för att hitta föregående nod.
-        }
-        if (temp == NULL) {
-            printf("Node not found in the list.\n"); // Felmeddelande om nästa nod inte hittas.
-            mem_free(new_node); // Frigör minnet för den nya noden om den inte kan infogas.
-            return;
-        }
-        new_node->next = temp->next;  // Länkar den nya noden till nästa nod.
-        temp->next = new_node;  // Lägger in den nya noden i listan före nästa nod.
-    }
-}
-
-// Funktion för att ta bort en nod med ett specifikt datavärde.
-void list_delete(Node** head, uint16_t data) {
-    if (*head == NULL) {
-        printf("List is empty.\n"); // Kontroll om listan är tom.
-        return;
-    }
-
-    Node* temp = *head;  // Temporär pekare för att gå igenom listan.
-    Node* prev = NULL; // Pekare för att hålla föregående nod.
-
-    if (temp != NULL && temp->data == data) {
-        *head = temp->next; // Om noden som ska tas bort är huvudnoden, uppdatera huvudet.
-        mem_free(temp);  // Frigör minnet för den borttagna noden.
-        return;
-    }
-
-    while (temp != NULL && temp->data != data) {
-        prev = temp; // Uppdatera föregående nod.
-        temp = temp->next; // Gå till nästa nod.
-    }
-
-    if (temp == NULL) {
-        printf("Data not found in the list.\n"); // Felmeddelande om datavärdet inte hittas.
-        return;
-    }
-
-    prev->next = temp->next;  // Ändrar föregående nods nästa pekare.
-    mem_free(temp);  // Frigör minnet för den borttagna noden.
-}  
-
-// Funktion för att söka efter en nod med ett specifikt datavärde.
-Node* list_search(Node** head, uint16_t data) {
-    Node* temp = *head;  // Temporär pekare
-    while (temp != NULL) {
-        if (temp->data == data) {
-            return temp; // Returnerar noden om datavärdet hittas.
-        }
-        temp = temp->next;  // Gå till nästa nod.
-    }
-    return NULL;  // Returnerar NULL om datavärdet inte hittas.
-}
-
-// Funktion för att räkna antalet noder i listan.
-int list_count_nodes(Node** head) {
-    int count = 0;
-    Node* temp = *head;
-    while (temp != NULL) {
-        count++; // Ökar räknaren.
-        temp = temp->next; // Gå till nästa nod.
-    }
-    return count;  // Returnerar antalet noder.
-}
-
-// Funktion för att rensa hela listan och frigöra minnet.
-void list_cleanup(Node** head) {
-    Node* temp = *head;
-    while (temp != NULL) {
-        Node* next = temp->next;  // Sparar pekaren till nästa nod.
-        mem_free(temp);  // Frigör minnet för den aktuella noden.
-        temp = next;  // Gå till nästa nod.
-    }
-    *head = NULL;  // Sätter huvudpekaren till NULL för att indikera att listan är tom.
-}
-
-// Funktion för att skriva ut hela listan.
-void list_display(Node** head) {
-    Node* temp = *head;
-
-    if (temp == NULL) {
-        printf("[]");  // Om listan är tom, skrivs tomma hakparenteser ut.
-        return;
-    }
-
-    printf("[");  // Skriv ut den öppna hakparentesen.
-    while (temp != NULL) {
-        printf("%d", temp->data);  // Skriv ut datavärdet för varje nod.
-        temp = temp->next;
-        if (temp != NULL) {
-            printf(", ");  // Om det finns fler noder, skriv ett komma efter datavärdet.
-        }
-    }
-    printf("]");  // Avsluta utskriften med en hakparentes.
-}
-
-// Funktion för att skriva ut noder inom ett visst intervall.
-void list_display_range(Node** head, Node* start_node, Node* end_node) {
-    Node* temp = (start_node != NULL) ? start_node : *head; // Om startnoden är NULL, starta från listans huvud.
-
-    if (temp == NULL) {
-        printf("[]");  // Om listan är tom, skrivs tomma hakparenteser ut.
-        return;
-    }
-
-    printf("[");
-    while (temp != NULL && (end_node == NULL || temp != end_node->next)) {
-        printf("%d", temp->data);  // Skriv ut datavärdet för varje nod inom intervallet.
-        temp = temp->next;
-        if (temp != NULL && (end_node == NULL || temp != end_node->next)) {
-            printf(", ");  // Om det finns fler noder inom intervallet, skriv ett komma efter datavärdet.
-        }
-    }
-    printf("]");
-}
-
-
-
-
-
-
-
-
-
-
-
-
-
-
-
-
-/*#include "linked_list.h"  // Includes the header file that defines the structure and functions of the linked list
-#include "memory_manager.h"
-
-
-
-
-void list_init(Node** head, size_t size) {
-    mem_init(size); // Initializes the memory manager with the specified size
-    *head = NULL;  // Sets the list's head to NULL (empty list)
-}
-
-// 
-void list_insert(Node** head, uint16_t data) {
-    Node* new_node = (Node*)mem_alloc(sizeof(Node)); // Allocates memory for a new node
-    if (new_node == NULL) {
-        // Checks if the memory allocation failed, Prints an error message
-        printf("Memory allocation failed.\n");
-        return;  // end the function if the allocation failed
-    }
-    new_node->data = data;  // Sets the data value for the new node
-    new_node->next = NULL; // Initially, the next node points to NULL
-
-    // Checks if the list is empty
-    if (*head == NULL) {
-        *head = new_node; // Sets the new node as the head of the list
-    } else {
-        Node* temp = *head;
-        while (temp->next != NULL) {
-            temp = temp->next; 
-        }
-        temp->next = new_node; // Adds the new node to the end of the list
-    }
-}
-
-// 
-void list_insert_after(Node* prev_node, uint16_t data) {
-    if (prev_node == NULL) {
-        // Checks if the previous node is NULL, Prints an error message
-        printf("Previous node cannot be NULL.\n");
-        return;
-    }
-    // Allocates memory for the new node
-    Node* new_node = (Node*)mem_alloc(sizeof(Node));
-    if (new_node == NULL) {  // Checks if the memory allocation failed, Prints an error message
-        printf("Memory allocation failed.\n"); 
-        return;
-    }
-    new_node->data = data;
-    new_node->next = prev_node->next;
-    prev_node->next = new_node;
-}
-
-
-void list_insert_before(Node** head, Node* next_node, uint16_t data) {
-    if (*head == NULL || next_node == NULL) { 
-        // Checks if the list is empty or if the next node is NULL, Prints an error message
-        printf("Cannot insert before NULL node.\n");
-        return;
-    }
-
-    Node* new_node = (Node*)mem_alloc(sizeof(Node));  // Allocates memory for the new node
-    if (new_node == NULL) {  // Checks if the memory allocation failed, Prints an error message
-        printf("Memory allocation failed.\n");
-        return;
-    }
-    new_node->data = data;
-
-    if (*head == next_node) { // Checks if the next node is the head of the list
-        new_node->next = *head;  // Links the new node's next to the head of the list
-        *head = new_node;   // Sets the new node as the head of the list
-    } else {
-        Node* temp = *head;
-        while (temp != NULL && temp->next != next_node) {
-            temp = temp->next;
-        }
-        if (temp == NULL) {
-            printf("Node not found in the list.\n");
-            mem_free(new_node);
-            return;
-        }
-        new_node->next = temp->next;  // Links the new node's next to next_node
-        temp->next = new_node;
-    }
-}
-
-// Removes a node with a specific data value
-void list_delete(Node** head, uint16_t data) {
-    if (*head == NULL) {
-        printf("List is empty.\n"); // Check if the list is empty
-        return;
-    }
-
-    Node* temp = *head;  // Temporary pointer to traverse the list
-    Node* prev = NULL; // Pointer to keep track of the previous node
-
-    if (temp != NULL && temp->data == data) {
-        // Om noden som ska tas bort är huvudnoden, Sätt listans huvud till nästa nod
-        *head = temp->next;
-        mem_free(temp);  // Free the memory for the removed node
-        return;
-    }
-
-    while (temp != NULL && temp->data != data) {
-        prev = temp; // Update the previous node
-        temp = temp->next; // Go to the next node
-    }
-
-    if (temp == NULL) { // Check if the data value was found
-        printf("Data not found in the list.\n");
-        return; // Exit the function if the data value was not found
-    }
-
-    prev->next = temp->next;  // Switch the previous node's next pointer
-    mem_free(temp);  // Free the memory for the removed node
-}  
-
-// Search for a node with a specific data value
-Node* list_search(Node** head, uint16_t data) {
-    Node* temp = *head;
-    while (temp != NULL) {
-        if (temp->data == data) {
-            return temp; // Return the node if the data value is found
-        }
-        temp = temp->next;  // Go to the next node
-    }
-    return NULL;  // Return NULL if the data value was not found
-}
-
-// Count the number of nodes in the list
-int list_count_nodes(Node** head) {
-    int count = 0;
-    Node* temp = *head;
-    while (temp != NULL) {
-        count++; // Increment the counter
-        temp = temp->next; // Go to the next node
-    }
-    return count;  // Return the number of nodes
-}
-
-// Clear the entire list and free the memory
-void list_cleanup(Node** head) {
-    Node* temp = *head;
-    while (temp != NULL) {
-        Node* next = temp->next;  //Save the pointer to the next node
-        mem_free(temp);  // Free the memory for the current node
-        temp = next;  // Go to the next node
-    }
-    *head = NULL;  // Set the list's head to NULL to indicate that the list is empty
-}
-
-// Display the entire list
-void list_display(Node** head) {
-    Node* temp = *head;
-
-    if (temp == NULL) {
-        printf("[]"); 
-        return;
-    }
-
-    printf("[");
-    while (temp != NULL) {
-        printf("%d", temp->data); 
-        temp = temp->next;
-        if (temp != NULL) {
-            printf(", "); 
-        }
-    }
-    printf("]"); 
-}
-
-// Display nodes within a certain range
-void list_display_range(Node** head, Node* start_node, Node* end_node) {
-    Node* temp = (start_node != NULL) ? start_node : *head; // If start node is NULL, start from the head of the list
-
-    if (temp == NULL) {
-        printf("[]");
-        return;
-    }
-
-    printf("[");
-    while (temp != NULL && (end_node == NULL || temp != end_node->next)) {
-        printf("%d", temp->data); // 
-        temp = temp->next;
-        if (temp != NULL && (end_node == NULL || temp != end_node->next)) {
-            printf(", "); // 
-        }
-    }
-    printf("]");
-}
-*/
+#include "linked_list.h"  // Inkluderar header-filen som definierar strukturen och funktionerna för den länkade listan.
+#include "memory_manager.h" // Inkluderar minneshanterarens funktioner som används för allokering och frigöring av minne.
+
+#include <pthread.h>
+
+// Antal noder som list_cleanup frigör per anrop till mem_free_batch
+#define CLEANUP_BATCH 256
+
+// En lista och arenan som dess noder allokeras ur. Listan känns igen på adressen
+// till dess huvudpekare, eftersom huvudet självt är NULL så länge listan är tom.
+// Noderna delas ut ur en objektpool i arenan, så de packas tätt och återanvänds direkt.
+typedef struct ListArena {
+    Node** head;
+    MemArena* arena;
+    MemObjectPool* nodes;
+} ListArena;
+
+static pthread_mutex_t list_arenas_lock = PTHREAD_MUTEX_INITIALIZER;  // Skyddar list_arenas
+static ListArena** list_arenas;       // Listor med egen arena, öppen adressering med huvudets adress som nyckel
+static size_t list_arena_count;       // Antal listor i list_arenas
+static size_t list_arena_capacity;    // Antal platser i list_arenas (alltid en tvåpotens)
+
+// Funktion för att räkna ut första platsen i list_arenas för en huvudpekare
+static size_t list_arena_slot(Node** head) {
+    // Fibonacci-hashning sprider närliggande adresser över hela tabellen
+    return (size_t)(((uint64_t)(uintptr_t)head * 0x9E3779B97F4A7C15ULL) >> (64 - __builtin_ctzll(list_arena_capacity)));
+}
+
+// Funktion för att hitta listans plats i list_arenas. Returnerar list_arena_capacity
+// om listan saknas. Anroparen håller list_arenas_lock.
+static size_t find_list_arena(Node** head) {
+    if (list_arena_capacity == 0) {
+        return 0;
+    }
+    size_t mask = list_arena_capacity - 1;
+    for (size_t slot = list_arena_slot(head); list_arenas[slot] != NULL; slot = (slot + 1) & mask) {
+        if (list_arenas[slot]->head == head) {
+            return slot;
+        }
+    }
+    return list_arena_capacity;  // Ingen träff
+}
+
+// Funktion för att lägga in en lista på första lediga plats efter dess hashplats.
+// Tabellen dubblas när den skulle bli mer än halvfull. Anroparen håller list_arenas_lock.
+static bool put_list_arena(ListArena* entry) {
+    if ((list_arena_count + 1) * 2 > list_arena_capacity) {
+        ListArena** old_table = list_arenas;
+        size_t old_capacity = list_arena_capacity;
+        size_t capacity = old_capacity > 0 ? old_capacity * 2 : 16;
+        ListArena** table = (ListArena**)calloc(capacity, sizeof(ListArena*));
+        if (table == NULL) {
+            return false;
+        }
+        list_arenas = table;
+        list_arena_capacity = capacity;
+        list_arena_count = 0;
+        for (size_t i = 0; i < old_capacity; i++) {
+            if (old_table[i] != NULL) {
+                put_list_arena(old_table[i]);  // Ryms alltid, så tabellen växer inte igen
+            }
+        }
+        free(old_table);
+    }
+
+    size_t mask = list_arena_capacity - 1;
+    size_t slot = list_arena_slot(entry->head);
+    while (list_arenas[slot] != NULL) {
+        slot = (slot + 1) & mask;  // Linjär sondering
+    }
+    list_arenas[slot] = entry;
+    list_arena_count++;
+    return true;
+}
+
+// Funktion för att ta bort listan på plats 'slot' ur list_arenas och returnera den.
+// Anroparen håller list_arenas_lock.
+static ListArena* take_list_arena(size_t slot) {
+    ListArena* found = list_arenas[slot];
+    size_t mask = list_arena_capacity - 1;
+    size_t hole = slot;
+
+    // Flytta bakåt de efterföljande listorna som annars inte längre skulle hittas
+    for (size_t next = (hole + 1) & mask; list_arenas[next] != NULL; next = (next + 1) & mask) {
+        size_t home = list_arena_slot(list_arenas[next]->head);
+        if (((next - home) & mask) >= ((next - hole) & mask)) {
+            list_arenas[hole] = list_arenas[next];
+            hole = next;
+        }
+    }
+    list_arenas[hole] = NULL;
+    list_arena_count--;
+    return found;
+}
+
+// Funktion för att hämta objektpoolen som en nod har allokerats ur. Poolen är knuten
+// till nodens arena, så ingen tabell behöver gås igenom.
+static MemObjectPool* node_pool(Node* node) {
+    MemArena* arena = mem_arena_of(node);
+    return arena != NULL ? (MemObjectPool*)mem_arena_user_data(arena) : NULL;
+}
+
+// Funktion för att hämta objektpoolen som listans noder allokeras ur. En lista som inte
+// finns under sin huvudpekare (till exempel en kopia av huvudet) hittar poolen via sin
+// första nod. Tomma listor som inte har initierats med list_init har ingen pool (NULL).
+static MemObjectPool* list_pool(Node** head) {
+    pthread_mutex_lock(&list_arenas_lock);
+    size_t slot = find_list_arena(head);
+    MemObjectPool* pool = slot < list_arena_capacity ? list_arenas[slot]->nodes : NULL;
+    pthread_mutex_unlock(&list_arenas_lock);
+    if (pool == NULL && *head != NULL) {
+        pool = node_pool(*head);
+    }
+    return pool;
+}
+
+// Funktion för att allokera en nod ur poolen. En lista utan pool har inte initierats,
+// eller så misslyckades list_init, och får då inga noder.
+static Node* node_alloc(MemObjectPool* pool) {
+    return pool != NULL ? (Node*)mem_object_pool_alloc(pool) : NULL;
+}
+
+// Funktion för att frigöra en nod som har allokerats med node_alloc
+static void node_free(MemObjectPool* pool, Node* node) {
+    if (pool != NULL) {
+        mem_object_pool_free(pool, node);
+    } else {
+        mem_free(node);
+    }
+}
+
+void list_init(Node** head, size_t size) {
+    *head = NULL;  // Sätter listans huvudpekare till NULL (vilket betyder att listan är tom).
+
+    // En tidigare lista på samma adress som aldrig städades bort rivs först, så att den nya
+    // listan aldrig får den gamla poolen, inte ens om den egna inte går att skapa
+    pthread_mutex_lock(&list_arenas_lock);
+    size_t slot = find_list_arena(head);
+    ListArena* stale = slot < list_arena_capacity ? take_list_arena(slot) : NULL;
+    pthread_mutex_unlock(&list_arenas_lock);
+    if (stale != NULL) {
+        mem_object_pool_destroy(stale->nodes);
+        mem_arena_destroy(stale->arena);
+        free(stale);
+    }
+
+    // Varje lista får en egen arena, så att flera listor kan finnas samtidigt
+    MemArena* arena = mem_arena_create(size);
+    if (arena == NULL) {
+        printf("Failed to initialize list.\n");  // Listan får då inga noder
+        return;
+    }
+    MemObjectPool* nodes = mem_object_pool_create(arena, sizeof(Node), _Alignof(Node));
+    if (nodes == NULL) {
+        printf("Failed to initialize list.\n");
+        mem_arena_destroy(arena);
+        return;
+    }
+
+    mem_arena_set_user_data(arena, nodes);  // Så att list_insert_after hittar poolen via en nod
+
+    pthread_mutex_lock(&list_arenas_lock);
+    ListArena* entry = (ListArena*)malloc(sizeof(ListArena));
+    if (entry != NULL) {
+        entry->head = head;
+        entry->arena = arena;
+        entry->nodes = nodes;
+    }
+    if (entry == NULL || !put_list_arena(entry)) {
+        pthread_mutex_unlock(&list_arenas_lock);
+        printf("Memory allocation failed.\n");
+        free(entry);
+        mem_object_pool_destroy(nodes);
+        mem_arena_destroy(arena);
+        return;
+    }
+    pthread_mutex_unlock(&list_arenas_lock);
+}
+
+// Funktion för att lägga till en ny nod i slutet av listan.
+void list_insert(Node** head, uint16_t data) {
+    Node* new_node = node_alloc(list_pool(head)); // Allokerar minne för en ny nod.
+    if (new_node == NULL) {
+        printf("Memory allocation failed.\n"); // Kontrollerar om minnesallokeringen misslyckades och skriver ett felmeddelande.
+        return;  // Avslutar funktionen om allokeringen misslyckades.
+    }
+    new_node->data = data;  // Sätter datavärdet för den nya noden.
+    new_node->next = NULL; // Noden pekar initialt på NULL (inget efterföljande element).
+
+    if (*head == NULL) {
+        *head = new_node; // Om listan är tom, sätts den nya noden som listans huvud.
+    } else {
+        Node* temp = *head;
+        while (temp->next != NULL) {
+            temp = temp->next; // Går till sista noden i listan.
+        }
+        temp->next = new_node; // Lägger till den nya noden i slutet av listan.
+    }
+}
+
+// Funktion för att lägga till en nod efter en given nod.
+void list_insert_after(Node* prev_node, uint16_t data) {
+    if (prev_node == NULL) {
+        printf("Previous node cannot be NULL.\n"); // Kontrollerar om föregående nod är NULL och skriver ett felmeddelande.
+        return;
+    }
+    Node* new_node = node_alloc(node_pool(prev_node)); // Allokerar minne i samma pool som föregående nod.
+    if (new_node == NULL) {
+        printf("Memory allocation failed.\n"); // Kontroll om minnesallokeringen misslyckas.
+        return;
+    }
+    new_node->data = data;
+    new_node->next = prev_node->next; // Sätter den nya nodens nästa pekare till föregående nods nästa nod.
+    prev_node->next = new_node; // Uppdaterar föregående nod så att den pekar på den nya noden.
+}
+
+// Funktion för att lägga till en nod innan en given nod.
+void list_insert_before(Node** head, Node* next_node, uint16_t data) {
+    if (*head == NULL || next_node == NULL) { 
+        printf("Cannot insert before NULL node.\n"); // Kontroll om listan är tom eller om nästa nod är NULL.
+        return;
+    }
+
+    MemObjectPool* pool = list_pool(head);
+    Node* new_node = node_alloc(pool);  // Allokerar minne för den nya noden.
+    if (new_node == NULL) {
+        printf("Memory allocation failed.\n"); // Kontroll om minnesallokeringen misslyckas.
+        return;
+    }
+    new_node->data = data;
+
+    if (*head == next_node) { // Kontroll om nästa nod är huvudnoden i listan.
+        new_node->next = *head;  // Sätter den nya nodens nästa pekare till huvudnoden.
+        *head = new_node;   // Gör den nya noden till listans nya huvud.
+    } else {
+        Node* temp = *head;
+        while (temp != NULL && temp->next != next_node) {
+            temp = temp->next; // Loopar igenom listan för att hitta föregående nod.
+        }
+        if (temp == NULL) {
+            printf("Node not found in the list.\n"); // Felmeddelande om nästa nod inte hittas.
+            node_free(pool, new_node); // Frigör minnet för den nya noden om den inte kan infogas.
+            return;
+        }
+        new_node->next = temp->next;  // Länkar den nya noden till nästa nod.
+        temp->next = new_node;  // Lägger in den nya noden i listan före nästa nod.
+    }
+}
+
+// Funktion för att ta bort en nod med ett specifikt datavärde.
+void list_delete(Node** head, uint16_t data) {
+    if (*head == NULL) {
+        printf("List is empty.\n"); // Kontroll om listan är tom.
+        return;
+    }
+
+    MemObjectPool* pool = list_pool(head);
+    Node* temp = *head;  // Temporär pekare för att gå igenom listan.
+    Node* prev = NULL; // Pekare för att hålla föregående nod.
+
+    if (temp != NULL && temp->data == data) {
+        *head = temp->next; // Om noden som ska tas bort är huvudnoden, uppdatera huvudet.
+        node_free(pool, temp);  // Frigör minnet för den borttagna noden.
+        return;
+    }
+
+    while (temp != NULL && temp->data != data) {
+        prev = temp; // Uppdatera föregående nod.
+        temp = temp->next; // Gå till nästa nod.
+    }
+
+    if (temp == NULL) {
+        printf("Data not found in the list.\n"); // Felmeddelande om datavärdet inte hittas.
+        return;
+    }
+
+    prev->next = temp->next;  // Ändrar föregående nods nästa pekare.
+    node_free(pool, temp);  // Frigör minnet för den borttagna noden.
+}  
+
+// Funktion för att söka efter en nod med ett specifikt datavärde.
+Node* list_search(Node** head, uint16_t data) {
+    Node* temp = *head;  // Temporär pekare
+    while (temp != NULL) {
+        if (temp->data == data) {
+            return temp; // Returnerar noden om datavärdet hittas.
+        }
+        temp = temp->next;  // Gå till nästa nod.
+    }
+    return NULL;  // Returnerar NULL om datavärdet inte hittas.
+}
+
+// Funktion för att räkna antalet noder i listan.
+int list_count_nodes(Node** head) {
+    int count = 0;
+    Node* temp = *head;
+    while (temp != NULL) {
+        count++; // Ökar räknaren.
+        temp = temp->next; // Gå till nästa nod.
+    }
+    return count;  // Returnerar antalet noder.
+}
+
+// Funktion för att rensa hela listan och frigöra minnet.
+void list_cleanup(Node** head) {
+    // En lista med egen arena rivs på en gång, utan att noderna gås igenom
+    pthread_mutex_lock(&list_arenas_lock);
+    size_t slot = find_list_arena(head);
+    if (slot < list_arena_capacity) {
+        ListArena* entry = take_list_arena(slot);
+        pthread_mutex_unlock(&list_arenas_lock);
+        mem_object_pool_destroy(entry->nodes);
+        mem_arena_destroy(entry->arena);
+        free(entry);
+        *head = NULL;
+        return;
+    }
+    pthread_mutex_unlock(&list_arenas_lock);
+
+    // En kopia av en lista med egen arena lämnar tillbaka noderna till poolen en och en
+    MemObjectPool* pool = *head != NULL ? node_pool(*head) : NULL;
+    if (pool != NULL) {
+        while (*head != NULL) {
+            Node* next = (*head)->next;
+            node_free(pool, *head);
+            *head = next;
+        }
+        return;
+    }
+
+    // Noderna samlas ihop och frigörs i satser, så att grannar slås ihop en gång per sats
+    Node* batch[CLEANUP_BATCH];
+    size_t count = 0;
+    Node* temp = *head;
+    while (temp != NULL) {
+        batch[count++] = temp;
+        temp = temp->next;  // Gå till nästa nod innan noden frigörs.
+        if (count == CLEANUP_BATCH || temp == NULL) {
+            mem_free_batch((void**)batch, count);
+            count = 0;
+        }
+    }
+    *head = NULL;  // Sätter huvudpekaren till NULL för att indikera att listan är tom.
+}
+
+// Funktion för att skriva ut hela listan.
+void list_display(Node** head) {
+    Node* temp = *head;
+
+    if (temp == NULL) {
+        printf("[]");  // Om listan är tom, skrivs tomma hakparenteser ut.
+        return;
+    }
+
+    printf("[");  // Skriv ut den öppna hakparentesen.
+    while (temp != NULL) {
+        printf("%d", temp->data);  // Skriv ut datavärdet för varje nod.
+        temp = temp->next;
+        if (temp != NULL) {
+            printf(", ");  // Om det finns fler noder, skriv ett komma efter datavärdet.
+        }
+    }
+    printf("]");  // Avsluta utskriften med en hakparentes.
+}
+
+// Funktion för att skriva ut noder inom ett visst intervall.
+void list_display_range(Node** head, Node* start_node, Node* end_node) {
+    Node* temp = (start_node != NULL) ? start_node : *head; // Om startnoden är NULL, starta från listans huvud.
+
+    if (temp == NULL) {
+        printf("[]");  // Om listan är tom, skrivs tomma hakparenteser ut.
+        return;
+    }
+
+    printf("[");
+    while (temp != NULL && (end_node == NULL || temp != end_node->next)) {
+        printf("%d", temp->data);  // Skriv ut datavärdet för varje nod inom intervallet.
+        temp = temp->next;
+        if (temp != NULL && (end_node == NULL || temp != end_node->next)) {
+            printf(", ");  // Om det finns fler noder inom intervallet, skriv ett komma efter datavärdet.
+        }
+    }
+    printf("]");
+}
+
+
+
+
+
+
+
+
+
+
+
+
+
+
+
+
+/*#include "linked_list.h"  // Includes the header file that defines the structure and functions of the linked list
+#include "memory_manager.h"
+
+
+
+
+void list_init(Node** head, size_t size) {
+    mem_init(size); // Initializes the memory manager with the specified size
+    *head = NULL;  // Sets the list's head to NULL (empty list)
+}
+
+// 
+void list_insert(Node** head, uint16_t data) {
+    Node* new_node = (Node*)mem_alloc(sizeof(Node)); // Allocates memory for a new node
+    if (new_node == NULL) {
+        // Checks if the memory allocation failed, Prints an error message
+        printf("Memory allocation failed.\n");
+        return;  // end the function if the allocation failed
+    }
+    new_node->data = data;  // Sets the data value for the new node
+    new_node->next = NULL; // Initially, the next node points to NULL
+
+    // Checks if the list is empty
+    if (*head == NULL) {
+        *head = new_node; // Sets the new node as the head of the list
+    } else {
+        Node* temp = *head;
+        while (temp->next != NULL) {
+            temp = temp->next; 
+        }
+        temp->next = new_node; // Adds the new node to the end of the list
+    }
+}
+
+// 
+void list_insert_after(Node* prev_node, uint16_t data) {
+    if (prev_node == NULL) {
+        // Checks if the previous node is NULL, Prints an error message
+        printf("Previous node cannot be NULL.\n");
+        return;
+    }
+    // Allocates memory for the new node
+    Node* new_node = (Node*)mem_alloc(sizeof(Node));
+    if (new_node == NULL) {  // Checks if the memory allocation failed, Prints an error message
+        printf("Memory allocation failed.\n"); 
+        return;
+    }
+    new_node->data = data;
+    new_node->next = prev_node->next;
+    prev_node->next = new_node;
+}
+
+
+void list_insert_before(Node** head, Node* next_node, uint16_t data) {
+    if (*head == NULL || next_node == NULL) { 
+        // Checks if the list is empty or if the next node is NULL, Prints an error message
+        printf("Cannot insert before NULL node.\n");
+        return;
+    }
+
+    Node* new_node = (Node*)mem_alloc(sizeof(Node));  // Allocates memory for the new node
+    if (new_node == NULL) {  // Checks if the memory allocation failed, Prints an error message
+        printf("Memory allocation failed.\n");
+        return;
+    }
+    new_node->data = data;
+
+    if (*head == next_node) { // Checks if the next node is the head of the list
+        new_node->next = *head;  // Links the new node's next to the head of the list
+        *head = new_node;   // Sets the new node as the head of the list
+    } else {
+        Node* temp = *head;
+        while (temp != NULL && temp->next != next_node) {
+            temp = temp->next;
+        }
+        if (temp == NULL) {
+            printf("Node not found in the list.\n");
+            mem_free(new_node);
+            return;
+        }
+        new_node->next = temp->next;  // Links the new node's next to next_node
+        temp->next = new_node;
+    }
+}
+
+// Removes a node with a specific data value
+void list_delete(Node** head, uint16_t data) {
+    if (*head == NULL) {
+        printf("List is empty.\n"); // Check if the list is empty
+        return;
+    }
+
+    Node* temp = *head;  // Temporary pointer to traverse the list
+    Node* prev = NULL; // Pointer to keep track of the previous node
+
+    if (temp != NULL && temp->data == data) {
+        // Om noden som ska tas bort är huvudnoden, Sätt listans huvud till nästa nod
+        *head = temp->next;
+        mem_free(temp);  // Free the memory for the removed node
+        return;
+    }
+
+    while (temp != NULL && temp->data != data) {
+        prev = temp; // Update the previous node
+        temp = temp->next; // Go to the next node
+    }
+
+    if (temp == NULL) { // Check if the data value was found
+        printf("Data not found in the list.\n");
+        return; // Exit the function if the data value was not found
+    }
+
+    prev->next = temp->next;  // Switch the previous node's next pointer
+    mem_free(temp);  // Free the memory for the removed node
+}  
+
+// Search for a node with a specific data value
+Node* list_search(Node** head, uint16_t data) {
+    Node* temp = *head;
+    while (temp != NULL) {
+        if (temp->data == data) {
+            return temp; // Return the node if the data value is found
+        }
+        temp = temp->next;  // Go to the next node
+    }
+    return NULL;  // Return NULL if the data value was not found
+}
+
+// Count the number of nodes in the list
+int list_count_nodes(Node** head) {
+    int count = 0;
+    Node* temp = *head;
+    while (temp != NULL) {
+        count++; // Increment the counter
+        temp = temp->next; // Go to the next node
+    }
+    return count;  // Return the number of nodes
+}
+
+// Clear the entire list and free the memory
+void list_cleanup(Node** head) {
+    Node* temp = *head;
+    while (temp != NULL) {
+        Node* next = temp->next;  //Save the pointer to the next node
+        mem_free(temp);  // Free the memory for the current node
+        temp = next;  // Go to the next node
+    }
+    *head = NULL;  // Set the list's head to NULL to indicate that the list is empty
+}
+
+// Display the entire list
+void list_display(Node** head) {
+    Node* temp = *head;
+
+    if (temp == NULL) {
+        printf("[]"); 
+        return;
+    }
+
+    printf("[");
+    while (temp != NULL) {
+        printf("%d", temp->data); 
+        temp = temp->next;
+        if (temp != NULL) {
+            printf(", "); 
+        }
+    }
+    printf("]"); 
+}
+
+// Display nodes within a certain range
+void list_display_range(Node** head, Node* start_node, Node* end_node) {
+    Node* temp = (start_node != NULL) ? start_node : *head; // If start node is NULL, start from the head of the list
+
+    if (temp == NULL) {
+        printf("[]");
+        return;
+    }
+
+    printf("[");
+    while (temp != NULL && (end_node == NULL || temp != end_node->next)) {
+        printf("%d", temp->data); // 
+        temp = temp->next;
+        if (temp != NULL && (end_node == NULL || temp != end_node->next)) {
+            printf(", "); // 
+        }
+    }
+    printf("]");
+}
+*/
@@ -0,0 +1,634 @@
+// mem_bench.c
+// Microbenchmarks for the memory manager, compared against the C library's malloc.
+// Every benchmark runs in its own child process so that peak RSS is measured per run.
+// Results are printed as CSV, one line per benchmark and allocator:
+//
+//   benchmark,allocator,threads,ops,ns_per_op,p99_ns,max_ns,peak_rss_kb
+//
+// ns_per_op comes from an untimed-per-call pass, p99_ns and max_ns from a second pass
+// that times every call. ns_per_op is wall time over the calls of all threads, so a benchmark that
+// scales shows a falling ns_per_op as threads are added.
+// Usage: mem_bench [filter], where filter selects benchmarks by name prefix.
+#include "memory_manager.h"
+
+#include <fcntl.h>
+#include <pthread.h>
+#include <sched.h>
+#include <sys/resource.h>
+#include <sys/wait.h>
+#include <time.h>
+#include <unistd.h>
+
+// Pool size used for the memory manager in every benchmark
+#define BENCH_POOL_SIZE ((size_t)256 * 1024 * 1024)
+
+// Number of calls each benchmark makes, split evenly between allocations and frees
+#define BENCH_OPS 1000000
+
+// Number of live blocks kept by the churn benchmarks
+#define CHURN_SLOTS 4096
+
+// Blocks allocated before they are freed in the LIFO and FIFO benchmarks
+#define BATCH_SIZE 1000
+
+// Slots in the queue between the producer and the consumer thread
+#define QUEUE_SLOTS 1024
+
+// Small blocks each thread in the contention benchmark holds before freeing them all
+#define CONTENTION_BATCH 512
+
+// Most threads a benchmark can use
+#define MAX_BENCH_THREADS 8
+
+// The fragmented benchmark fills the pool with holes that are too small for its requests,
+// kept apart by fences, and a few larger holes that the requests can actually use.
+// Together the holes and fences make a pool of just over 100k blocks.
+#define FRAG_HOLES 50000
+#define FRAG_HOLE_SIZE 1040
+#define FRAG_FENCE_SIZE 272
+#define FRAG_TARGETS 1000
+#define FRAG_TARGET_SIZE 2032
+#define FRAG_REQUEST_SIZE 1500
+
+typedef struct Allocator
+{
+    const char *name;
+    void (*setup)(void);
+    void (*teardown)(void);
+    void *(*alloc)(size_t size);
+    void (*free)(void *block);
+    void *(*resize)(void *block, size_t size);
+} Allocator;
+
+// Latencies of individual calls, in nanoseconds
+typedef struct Recorder
+{
+    uint64_t *samples;
+    size_t count;
+    size_t capacity;
+} Recorder;
+
+typedef struct Benchmark
+{
+    const char *name;
+    int threads;
+    // Runs the benchmark on 'threads' threads and returns the number of calls made.
+    // Calls are timed one by one into 'recorder' when it is not NULL.
+    size_t (*run)(const Allocator *allocator, Recorder *recorder, int threads);
+    // Optional untimed set-up, run before each pass
+    void (*prepare)(const Allocator *allocator);
+} Benchmark;
+
+static uint64_t now_ns(void)
+{
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (uint64_t)now.tv_sec * 1000000000 + (uint64_t)now.tv_nsec;
+}
+
+// Runs 'call' and, when recording, stores how long it took
+#define TIMED(recorder, call)                                                  \
+    do                                                                         \
+    {                                                                          \
+        if ((recorder) != NULL && (recorder)->count < (recorder)->capacity)    \
+        {                                                                      \
+            uint64_t timed_start = now_ns();                                   \
+            call;                                                              \
+            (recorder)->samples[(recorder)->count++] = now_ns() - timed_start; \
+        }                                                                      \
+        else                                                                   \
+        {                                                                      \
+            call;                                                              \
+        }                                                                      \
+    } while (0)
+
+// Small xorshift generator, so both allocators see the same sizes
+static uint64_t next_random(uint64_t *state)
+{
+    *state ^= *state << 13;
+    *state ^= *state >> 7;
+    *state ^= *state << 17;
+    return *state;
+}
+
+// Writes to a new block so that its pages count towards RSS
+static void touch(void *block, size_t size)
+{
+    if (block != NULL && size > 0)
+    {
+        ((char *)block)[0] = 1;
+        ((char *)block)[size - 1] = 1;
+    }
+}
+
+static void mem_setup(void)
+{
+    mem_init(BENCH_POOL_SIZE);
+}
+
+static void mem_next_fit_setup(void)
+{
+    MemOptions options = {0};
+    options.placement = MEM_PLACEMENT_NEXT_FIT;
+    mem_init_with_options(BENCH_POOL_SIZE, &options);
+}
+
+static void mem_best_fit_setup(void)
+{
+    MemOptions options = {0};
+    options.placement = MEM_PLACEMENT_BEST_FIT;
+    mem_init_with_options(BENCH_POOL_SIZE, &options);
+}
+
+static void libc_setup(void)
+{
+}
+
+static void libc_teardown(void)
+{
+}
+
+static void mem_tlsf_setup(void)
+{
+    MemOptions options = {0};
+    options.placement = MEM_PLACEMENT_TLSF;
+    mem_init_with_options(BENCH_POOL_SIZE, &options);
+}
+
+static void mem_buddy_setup(void)
+{
+    MemOptions options = {0};
+    options.placement = MEM_PLACEMENT_BUDDY;
+    mem_init_with_options(BENCH_POOL_SIZE, &options);
+}
+
+static const Allocator allocators[] = {
+    {"mem", mem_setup, mem_deinit, mem_alloc, mem_free, mem_resize},
+    {"mem_next_fit", mem_next_fit_setup, mem_deinit, mem_alloc, mem_free, mem_resize},
+    {"mem_best_fit", mem_best_fit_setup, mem_deinit, mem_alloc, mem_free, mem_resize},
+    {"mem_tlsf", mem_tlsf_setup, mem_deinit, mem_alloc, mem_free, mem_resize},
+    {"mem_buddy", mem_buddy_setup, mem_deinit, mem_alloc, mem_free, mem_resize},
+    {"libc", libc_setup, libc_teardown, malloc, free, realloc},
+};
+
+// Frees and reallocates random slots among a fixed set of live blocks of one size
+static size_t bench_churn_fixed(const Allocator *allocator, Recorder *recorder, int threads)
+{
+    (void)threads;
+    static void *slots[CHURN_SLOTS];
+    uint64_t state = 88172645463325252ULL;
+    size_t ops = 0;
+    memset(slots, 0, sizeof(slots));
+    while (ops < BENCH_OPS)
+    {
+        size_t slot = next_random(&state) % CHURN_SLOTS;
+        if (slots[slot] != NULL)
+        {
+            TIMED(recorder, allocator->free(slots[slot]));
+            ops++;
+        }
+        TIMED(recorder, slots[slot] = allocator->alloc(64));
+        ops++;
+        touch(slots[slot], 64);
+    }
+    for (size_t slot = 0; slot < CHURN_SLOTS; slot++)
+    {
+        if (slots[slot] != NULL)
+        {
+            allocator->free(slots[slot]);
+        }
+    }
+    return ops;
+}
+
+// Like the fixed churn, but every block gets a random size between 16 bytes and 4 KB
+static size_t bench_random_sizes(const Allocator *allocator, Recorder *recorder, int threads)
+{
+    (void)threads;
+    static void *slots[CHURN_SLOTS];
+    uint64_t state = 2463534242ULL;
+    size_t ops = 0;
+    memset(slots, 0, sizeof(slots));
+    while (ops < BENCH_OPS)
+    {
+        size_t slot = next_random(&state) % CHURN_SLOTS;
+        size_t size = 16 + next_random(&state) % 4081;
+        if (slots[slot] != NULL)
+        {
+            TIMED(recorder, allocator->free(slots[slot]));
+            ops++;
+        }
+        TIMED(recorder, slots[slot] = allocator->alloc(size));
+        ops++;
+        touch(slots[slot], size);
+    }
+    for (size_t slot = 0; slot < CHURN_SLOTS; slot++)
+    {
+        if (slots[slot] != NULL)
+        {
+            allocator->free(slots[slot]);
+        }
+    }
+    return ops;
+}
+
+// Allocates a batch of blocks and frees them in the order given by 'reverse'
+static size_t run_batches(const Allocator *allocator, Recorder *recorder, bool reverse)
+{
+    static void *batch[BATCH_SIZE];
+    for (size_t round = 0; round < BENCH_OPS / (2 * BATCH_SIZE); round++)
+    {
+        for (size_t i = 0; i < BATCH_SIZE; i++)
+        {
+            TIMED(recorder, batch[i] = allocator->alloc(128));
+            touch(batch[i], 128);
+        }
+        for (size_t i = 0; i < BATCH_SIZE; i++)
+        {
+            size_t index = reverse ? BATCH_SIZE - 1 - i : i;
+            TIMED(recorder, allocator->free(batch[index]));
+        }
+    }
+    return BENCH_OPS;
+}
+
+// Frees every batch newest first
+static size_t bench_lifo(const Allocator *allocator, Recorder *recorder, int threads)
+{
+    (void)threads;
+    return run_batches(allocator, recorder, true);
+}
+
+// Frees every batch oldest first
+static size_t bench_fifo(const Allocator *allocator, Recorder *recorder, int threads)
+{
+    (void)threads;
+    return run_batches(allocator, recorder, false);
+}
+
+// Grows blocks step by step with resize, as a growing buffer would
+static size_t bench_resize_growth(const Allocator *allocator, Recorder *recorder, int threads)
+{
+    (void)threads;
+    size_t ops = 0;
+    while (ops < BENCH_OPS)
+    {
+        void *block;
+        TIMED(recorder, block = allocator->alloc(16));
+        ops++;
+        for (size_t size = 64; size <= 16384 && ops < BENCH_OPS; size += 64)
+        {
+            void *grown;
+            TIMED(recorder, grown = allocator->resize(block, size));
+            ops++;
+            if (grown == NULL)
+            {
+                break;
+            }
+            block = grown;
+            touch(block, size);
+        }
+        TIMED(recorder, allocator->free(block));
+        ops++;
+    }
+    return ops;
+}
+
+// Queue from the producer to the consumer thread. Each side only writes its own index.
+typedef struct Queue
+{
+    void *slots[QUEUE_SLOTS];
+    size_t head; // Next slot the producer fills
+    size_t tail; // Next slot the consumer empties
+    const Allocator *allocator;
+    Recorder *recorder;
+} Queue;
+
+static void *consumer_main(void *arg)
+{
+    Queue *queue = (Queue *)arg;
+    for (size_t i = 0; i < BENCH_OPS / 2; i++)
+    {
+        while (__atomic_load_n(&queue->head, __ATOMIC_ACQUIRE) == queue->tail)
+        {
+            sched_yield(); // Wait for the producer without starving it on a single core
+        }
+        void *block = queue->slots[queue->tail % QUEUE_SLOTS];
+        TIMED(queue->recorder, queue->allocator->free(block));
+        __atomic_store_n(&queue->tail, queue->tail + 1, __ATOMIC_RELEASE);
+    }
+    return NULL;
+}
+
+// One thread allocates and another frees, so every free is a cross-thread free
+static size_t bench_producer_consumer(const Allocator *allocator, Recorder *recorder, int threads)
+{
+    (void)threads;
+    static Queue queue;
+    Recorder consumer_recorder = {NULL, 0, 0};
+    if (recorder != NULL)
+    {
+        // The consumer records into the second half of the buffer
+        consumer_recorder.samples = recorder->samples + recorder->capacity / 2;
+        consumer_recorder.capacity = recorder->capacity - recorder->capacity / 2;
+        recorder->capacity /= 2;
+    }
+    memset(&queue, 0, sizeof(queue));
+    queue.allocator = allocator;
+    queue.recorder = recorder != NULL ? &consumer_recorder : NULL;
+
+    pthread_t consumer;
+    if (pthread_create(&consumer, NULL, consumer_main, &queue) != 0)
+    {
+        return 0;
+    }
+    for (size_t i = 0; i < BENCH_OPS / 2; i++)
+    {
+        while (i - __atomic_load_n(&queue.tail, __ATOMIC_ACQUIRE) >= QUEUE_SLOTS)
+        {
+            sched_yield(); // Wait for the consumer to make room
+        }
+        void *block;
+        TIMED(recorder, block = allocator->alloc(64));
+        touch(block, 64);
+        queue.slots[i % QUEUE_SLOTS] = block;
+        __atomic_store_n(&queue.head, i + 1, __ATOMIC_RELEASE);
+    }
+    pthread_join(consumer, NULL);
+
+    if (recorder != NULL)
+    {
+        // Move the consumer's samples down behind the producer's
+        memmove(recorder->samples + recorder->count, consumer_recorder.samples,
+                consumer_recorder.count * sizeof(uint64_t));
+        recorder->count += consumer_recorder.count;
+        recorder->capacity += consumer_recorder.capacity;
+    }
+    return BENCH_OPS;
+}
+
+// One contention thread, with its own part of the latency buffer
+typedef struct Contender
+{
+    const Allocator *allocator;
+    Recorder recorder;
+    bool recording;
+    size_t ops;
+    uint64_t seed;
+} Contender;
+
+static void *contender_main(void *arg)
+{
+    Contender *contender = (Contender *)arg;
+    Recorder *recorder = contender->recording ? &contender->recorder : NULL;
+    void *batch[CONTENTION_BATCH];
+    uint64_t state = contender->seed;
+    size_t ops = 0;
+    while (ops < contender->ops)
+    {
+        // Fill and then empty whole spans, so they keep returning to the shared pool
+        size_t count = (contender->ops - ops) / 2 < CONTENTION_BATCH ? (contender->ops - ops) / 2 : CONTENTION_BATCH;
+        if (count == 0)
+        {
+            break;
+        }
+        size_t size = 16 + next_random(&state) % 241;
+        for (size_t i = 0; i < count; i++)
+        {
+            TIMED(recorder, batch[i] = contender->allocator->alloc(size));
+            touch(batch[i], size);
+        }
+        for (size_t i = 0; i < count; i++)
+        {
+            TIMED(recorder, contender->allocator->free(batch[i]));
+        }
+        ops += 2 * count;
+    }
+    contender->ops = ops;
+    return NULL;
+}
+
+// Every thread allocates and frees its own small blocks, so the only thing the threads
+// share is the allocator itself. The calls are split evenly between the threads.
+static size_t bench_contention(const Allocator *allocator, Recorder *recorder, int threads)
+{
+    static Contender contenders[MAX_BENCH_THREADS];
+    pthread_t ids[MAX_BENCH_THREADS];
+    size_t share = recorder != NULL ? recorder->capacity / (size_t)threads : 0;
+    for (int t = 0; t < threads; t++)
+    {
+        Contender *contender = &contenders[t];
+        memset(contender, 0, sizeof(*contender));
+        contender->allocator = allocator;
+        contender->ops = BENCH_OPS / (size_t)threads;
+        contender->seed = 88172645463325252ULL + (uint64_t)t;
+        if (recorder != NULL)
+        {
+            contender->recording = true;
+            contender->recorder.samples = recorder->samples + (size_t)t * share;
+            contender->recorder.capacity = share;
+        }
+    }
+    int started = 0;
+    for (; started < threads; started++)
+    {
+        if (pthread_create(&ids[started], NULL, contender_main, &contenders[started]) != 0)
+        {
+            break;
+        }
+    }
+    size_t ops = 0;
+    for (int t = 0; t < started; t++)
+    {
+        pthread_join(ids[t], NULL);
+        ops += contenders[t].ops;
+        if (recorder != NULL)
+        {
+            // Gather every thread's samples at the start of the buffer
+            memmove(recorder->samples + recorder->count, contenders[t].recorder.samples,
+                    contenders[t].recorder.count * sizeof(uint64_t));
+            recorder->count += contenders[t].recorder.count;
+        }
+    }
+    return started == threads ? ops : 0;
+}
+
+// Blocks of the fragmented benchmark that outlive the timed calls
+static struct
+{
+    void *fences[FRAG_HOLES + FRAG_TARGETS];
+    void *holes[FRAG_HOLES];
+    void *targets[FRAG_TARGETS];
+    void *filler;
+} fragmented;
+
+// Lays out the pool as small holes, each behind a fence, with the larger holes allocated
+// first and freed first, so a first-fit walk of their free list finds them last. The
+// rest of the pool is taken, so there is no larger free block to fall back on.
+static void prepare_fragmented(const Allocator *allocator)
+{
+    size_t used = 0;
+    for (size_t i = 0; i < FRAG_TARGETS; i++)
+    {
+        fragmented.targets[i] = allocator->alloc(FRAG_TARGET_SIZE);
+        fragmented.fences[i] = allocator->alloc(FRAG_FENCE_SIZE);
+        used += FRAG_TARGET_SIZE + FRAG_FENCE_SIZE;
+    }
+    for (size_t i = 0; i < FRAG_HOLES; i++)
+    {
+        fragmented.holes[i] = allocator->alloc(FRAG_HOLE_SIZE);
+        fragmented.fences[FRAG_TARGETS + i] = allocator->alloc(FRAG_FENCE_SIZE);
+        used += FRAG_HOLE_SIZE + FRAG_FENCE_SIZE;
+    }
+    fragmented.filler = allocator->alloc(BENCH_POOL_SIZE - used);
+    for (size_t i = 0; i < FRAG_TARGETS; i++)
+    {
+        allocator->free(fragmented.targets[i]);
+    }
+    for (size_t i = 0; i < FRAG_HOLES; i++)
+    {
+        allocator->free(fragmented.holes[i]);
+    }
+}
+
+// Allocates from a nearly full, fragmented pool where only a few free blocks fit the
+// request, which is the worst case for a search that walks a free list
+static size_t bench_fragmented(const Allocator *allocator, Recorder *recorder, int threads)
+{
+    (void)threads;
+    for (size_t i = 0; i < FRAG_TARGETS; i++)
+    {
+        TIMED(recorder, fragmented.targets[i] = allocator->alloc(FRAG_REQUEST_SIZE));
+        touch(fragmented.targets[i], FRAG_REQUEST_SIZE);
+    }
+    for (size_t i = 0; i < FRAG_TARGETS; i++)
+    {
+        TIMED(recorder, allocator->free(fragmented.targets[i]));
+    }
+    for (size_t i = 0; i < FRAG_HOLES + FRAG_TARGETS; i++)
+    {
+        allocator->free(fragmented.fences[i]);
+    }
+    if (fragmented.filler != NULL)
+    {
+        allocator->free(fragmented.filler);
+    }
+    return 2 * FRAG_TARGETS;
+}
+
+static const Benchmark benchmarks[] = {
+    {.name = "churn_fixed", .threads = 1, .run = bench_churn_fixed, .prepare = NULL},
+    {.name = "random_sizes", .threads = 1, .run = bench_random_sizes, .prepare = NULL},
+    {.name = "lifo", .threads = 1, .run = bench_lifo, .prepare = NULL},
+    {.name = "fifo", .threads = 1, .run = bench_fifo, .prepare = NULL},
+    {.name = "producer_consumer", .threads = 2, .run = bench_producer_consumer, .prepare = NULL},
+    {.name = "resize_growth", .threads = 1, .run = bench_resize_growth, .prepare = NULL},
+    {.name = "contention", .threads = 1, .run = bench_contention, .prepare = NULL},
+    {.name = "contention", .threads = 2, .run = bench_contention, .prepare = NULL},
+    {.name = "contention", .threads = 4, .run = bench_contention, .prepare = NULL},
+    {.name = "contention", .threads = 8, .run = bench_contention, .prepare = NULL},
+    {.name = "fragmented", .threads = 1, .run = bench_fragmented, .prepare = prepare_fragmented},
+};
+
+static int compare_samples(const void *a, const void *b)
+{
+    uint64_t x = *(const uint64_t *)a;
+    uint64_t y = *(const uint64_t *)b;
+    return (x > y) - (x < y);
+}
+
+// Runs one benchmark with one allocator and prints its CSV line. Runs in a child process.
+static void run_child(const Benchmark *benchmark, const Allocator *allocator)
+{
+    // The memory manager reports failed calls on stdout; keep them out of the CSV
+    fflush(stdout);
+    int csv = dup(STDOUT_FILENO);
+    int null = open("/dev/null", O_WRONLY);
+    if (null >= 0)
+    {
+        dup2(null, STDOUT_FILENO);
+        close(null);
+    }
+
+    // Throughput pass, without per-call timing
+    allocator->setup();
+    if (benchmark->prepare != NULL)
+    {
+        benchmark->prepare(allocator);
+    }
+    uint64_t start = now_ns();
+    size_t ops = benchmark->run(allocator, NULL, benchmark->threads);
+    uint64_t elapsed = now_ns() - start;
+    allocator->teardown();
+
+    // RSS is read before the latency buffer is allocated, so it does not count
+    struct rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+    long peak_rss_kb = usage.ru_maxrss;
+
+    // Latency pass
+    Recorder recorder = {malloc(2 * BENCH_OPS * sizeof(uint64_t)), 0, 2 * BENCH_OPS};
+    uint64_t p99 = 0;
+    uint64_t max = 0;
+    if (recorder.samples != NULL)
+    {
+        allocator->setup();
+        if (benchmark->prepare != NULL)
+        {
+            benchmark->prepare(allocator);
+        }
+        benchmark->run(allocator, &recorder, benchmark->threads);
+        allocator->teardown();
+        if (recorder.count > 0)
+        {
+            qsort(recorder.samples, recorder.count, sizeof(uint64_t), compare_samples);
+            p99 = recorder.samples[recorder.count * 99 / 100];
+            max = recorder.samples[recorder.count - 1];
+        }
+        free(recorder.samples);
+    }
+
+    fflush(stdout);
+    if (csv >= 0)
+    {
+        dup2(csv, STDOUT_FILENO);
+        close(csv);
+    }
+    printf("%s,%s,%d,%zu,%.2f,%llu,%llu,%ld\n", benchmark->name, allocator->name, benchmark->threads, ops,
+           ops > 0 ? (double)elapsed / (double)ops : 0.0, (unsigned long long)p99, (unsigned long long)max,
+           peak_rss_kb);
+    fflush(stdout);
+}
+
+int main(int argc, char *argv[])
+{
+    const char *filter = argc > 1 ? argv[1] : "";
+    printf("benchmark,allocator,threads,ops,ns_per_op,p99_ns,max_ns,peak_rss_kb\n");
+    fflush(stdout);
+
+    int failures = 0;
+    for (size_t b = 0; b < sizeof(benchmarks) / sizeof(benchmarks[0]); b++)
+    {
+        if (strncmp(benchmarks[b].name, filter, strlen(filter)) != 0)
+        {
+            continue;
+        }
+        for (size_t a = 0; a < sizeof(allocators) / sizeof(allocators[0]); a++)
+        {
+            pid_t child = fork();
+            if (child == 0)
+            {
+                run_child(&benchmarks[b], &allocators[a]);
+                _exit(EXIT_SUCCESS);
+            }
+            int status = 0;
+            if (child < 0 || waitpid(child, &status, 0) < 0 || !WIFEXITED(status) ||
+                WEXITSTATUS(status) != EXIT_SUCCESS)
+            {
+                fprintf(stderr, "%s with %s failed.\n", benchmarks[b].name, allocators[a].name);
+                failures++;
+            }
+        }
+    }
+    return failures == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,249 @@
+// mem_replay.c
+// Replays an allocation trace written by a library built with -DMEM_TRACE against the
+// memory manager, and reports throughput, peak footprint and fragmentation over time.
+//
+// Usage: mem_replay <trace> [pool_size [max_size [placement]]]
+// where placement is size-classes (default), next-fit, best-fit, tlsf or buddy.
+#include "memory_manager.h"
+#include "mem_trace.h"
+
+#include <time.h>
+
+// Number of operations between two samples of the allocator statistics. The samples
+// are taken outside the timed sections, so they do not count against throughput.
+#define SAMPLE_INTERVAL 64
+
+// Number of rows in the fragmentation timeline
+#define TIMELINE_ROWS 20
+
+static double seconds_now(void)
+{
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (double)now.tv_sec + (double)now.tv_nsec / 1e9;
+}
+
+static double fragmentation_of(const MemStats *stats)
+{
+    if (stats->bytes_free == 0)
+    {
+        return 0.0;
+    }
+    return 1.0 - (double)stats->largest_free_block / (double)stats->bytes_free;
+}
+
+// Reads the whole trace into memory. Returns the records and sets *count, or NULL
+static MemTraceRecord *load_trace(const char *path, size_t *count)
+{
+    FILE *file = fopen(path, "rb");
+    if (file == NULL)
+    {
+        printf("Failed to open %s.\n", path);
+        return NULL;
+    }
+    MemTraceHeader header;
+    if (fread(&header, sizeof(header), 1, file) != 1 || header.magic != MEM_TRACE_MAGIC ||
+        header.version != MEM_TRACE_VERSION)
+    {
+        printf("%s is not a version %d allocation trace.\n", path, MEM_TRACE_VERSION);
+        fclose(file);
+        return NULL;
+    }
+
+    size_t capacity = 4096;
+    size_t used = 0;
+    MemTraceRecord *records = malloc(capacity * sizeof(MemTraceRecord));
+    while (records != NULL)
+    {
+        if (used == capacity)
+        {
+            capacity *= 2;
+            MemTraceRecord *grown = realloc(records, capacity * sizeof(MemTraceRecord));
+            if (grown == NULL)
+            {
+                free(records);
+                records = NULL;
+                break;
+            }
+            records = grown;
+        }
+        size_t read = fread(records + used, sizeof(MemTraceRecord), capacity - used, file);
+        used += read;
+        if (read == 0)
+        {
+            break;
+        }
+    }
+    fclose(file);
+    if (records == NULL)
+    {
+        printf("Out of memory reading %s.\n", path);
+        return NULL;
+    }
+    *count = used;
+    return records;
+}
+
+// Performs one traced call. 'blocks' maps trace ids to the blocks of this run.
+// Returns false if a call that succeeded in the trace fails here.
+static bool replay_one(const MemTraceRecord *record, void **blocks, uint32_t max_id, size_t pool_size,
+                       const MemOptions *options)
+{
+    void **slot = record->id != 0 && record->id <= max_id ? &blocks[record->id] : NULL;
+    switch (record->op)
+    {
+    case MEM_TRACE_ALLOC:
+    {
+        void *block = mem_alloc(record->size);
+        if (slot != NULL)
+        {
+            *slot = block;
+            return block != NULL;
+        }
+        if (block != NULL && record->size > 0)
+        {
+            mem_free(block); // Failed in the trace, so it must not stay live here
+        }
+        return true;
+    }
+    case MEM_TRACE_FREE:
+        if (slot != NULL && *slot != NULL)
+        {
+            mem_free(*slot);
+            *slot = NULL;
+        }
+        return true;
+    case MEM_TRACE_RESIZE:
+        if (slot != NULL && *slot != NULL)
+        {
+            void *block = mem_resize(*slot, record->size);
+            if (block == NULL)
+            {
+                return false;
+            }
+            *slot = block;
+        }
+        return true;
+    case MEM_TRACE_RESET:
+        mem_init_with_options(pool_size, options);
+        memset(blocks, 0, (max_id + 1) * sizeof(void *));
+        return true;
+    default:
+        return true;
+    }
+}
+
+// Placement policies by the names accepted on the command line
+static const struct
+{
+    const char *name;
+    MemPlacement placement;
+} placements[] = {
+    {"size-classes", MEM_PLACEMENT_SIZE_CLASSES},
+    {"next-fit", MEM_PLACEMENT_NEXT_FIT},
+    {"best-fit", MEM_PLACEMENT_BEST_FIT},
+    {"tlsf", MEM_PLACEMENT_TLSF},
+    {"buddy", MEM_PLACEMENT_BUDDY},
+};
+
+int main(int argc, char *argv[])
+{
+    if (argc < 2)
+    {
+        printf("Usage: %s <trace> [pool_size [max_size [size-classes|next-fit|best-fit|tlsf|buddy]]]\n", argv[0]);
+        return EXIT_FAILURE;
+    }
+    size_t pool_size = argc > 2 ? strtoull(argv[2], NULL, 0) : POOL_SIZE;
+    MemOptions options = {0};
+    options.max_size = argc > 3 ? strtoull(argv[3], NULL, 0) : 0;
+    const char *placement = argc > 4 ? argv[4] : placements[0].name;
+    size_t known = sizeof(placements) / sizeof(placements[0]);
+    size_t p = 0;
+    while (p < known && strcmp(placements[p].name, placement) != 0)
+    {
+        p++;
+    }
+    if (p == known)
+    {
+        printf("Unknown placement %s.\n", placement);
+        return EXIT_FAILURE;
+    }
+    options.placement = placements[p].placement;
+
+    size_t count = 0;
+    MemTraceRecord *records = load_trace(argv[1], &count);
+    if (records == NULL)
+    {
+        return EXIT_FAILURE;
+    }
+    uint32_t max_id = 0;
+    for (size_t i = 0; i < count; i++)
+    {
+        if (records[i].id > max_id)
+        {
+            max_id = records[i].id;
+        }
+    }
+    void **blocks = calloc((size_t)max_id + 1, sizeof(void *));
+    if (blocks == NULL)
+    {
+        printf("Out of memory.\n");
+        free(records);
+        return EXIT_FAILURE;
+    }
+
+    mem_init_with_options(pool_size, &options);
+    printf("Replaying %zu calls, %u blocks, pool %zu bytes, %s placement\n\n", count, max_id, pool_size, placement);
+    printf("%12s %14s %14s %14s %14s\n", "call", "in use", "free", "largest free", "fragmentation");
+
+    size_t timeline_step = count / TIMELINE_ROWS > 0 ? count / TIMELINE_ROWS : 1;
+    size_t next_row = 0;
+    size_t peak_in_use = 0;
+    size_t peak_pool = 0;
+    size_t mismatches = 0;
+    double elapsed = 0.0;
+    for (size_t done = 0; done < count;)
+    {
+        size_t end = done + SAMPLE_INTERVAL < count ? done + SAMPLE_INTERVAL : count;
+        double start = seconds_now();
+        for (; done < end; done++)
+        {
+            if (!replay_one(&records[done], blocks, max_id, pool_size, &options))
+            {
+                mismatches++;
+            }
+        }
+        elapsed += seconds_now() - start;
+
+        MemStats stats = mem_get_stats();
+        if (stats.bytes_in_use > peak_in_use)
+        {
+            peak_in_use = stats.bytes_in_use;
+        }
+        if (stats.pool_size > peak_pool)
+        {
+            peak_pool = stats.pool_size;
+        }
+        if (done >= next_row || done == count)
+        {
+            printf("%12zu %14zu %14zu %14zu %14.3f\n", done, stats.bytes_in_use, stats.bytes_free,
+                   stats.largest_free_block, fragmentation_of(&stats));
+            next_row = done + timeline_step;
+        }
+    }
+
+    MemStats stats = mem_get_stats();
+    double traced = count > 0 ? (double)records[count - 1].timestamp / 1e9 : 0.0;
+    printf("\nCalls:               %zu\n", count);
+    printf("Replay time:         %.6f s (traced run took %.6f s)\n", elapsed, traced);
+    printf("Throughput:          %.0f calls/s\n", elapsed > 0.0 ? (double)count / elapsed : 0.0);
+    printf("Peak bytes in use:   %zu (sampled every %d calls)\n", peak_in_use, SAMPLE_INTERVAL);
+    printf("Peak pool size:      %zu\n", peak_pool);
+    printf("Average search:      %.2f free blocks (max %zu)\n", stats.avg_search_length, stats.max_search_length);
+    printf("Failed only here:    %zu\n", mismatches);
+
+    mem_deinit();
+    free(blocks);
+    free(records);
+    return EXIT_SUCCESS;
+}
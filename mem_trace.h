@@ -0,0 +1,41 @@
+#ifndef MEM_TRACE_H
+#define MEM_TRACE_H
+
+#include <stdint.h>  // Includes standardized integer types
+
+// Binary allocation trace written by a library built with -DMEM_TRACE (make TRACE=1)
+// and read by mem_replay. Every mem_alloc, mem_free and mem_resize call on the default
+// pool is appended to the file named by the MEM_TRACE_FILE environment variable, or
+// mem_trace.bin in the working directory. mem_alloc_aligned is recorded as an alloc,
+// mem_alloc_batch and mem_free_batch as one alloc or free per block, and mem_release
+// as one free per block it releases.
+//
+// The file starts with a MemTraceHeader followed by MemTraceRecords in call order.
+// Blocks are identified by ids rather than addresses, so a trace can be replayed
+// against a different allocator. Id 0 means the call did not refer to a live block:
+// a failed allocation, a zero-byte allocation, or a free of an unknown pointer.
+
+#define MEM_TRACE_MAGIC 0x4352544Du  // "MTRC" in little-endian byte order
+#define MEM_TRACE_VERSION 1
+
+typedef enum MemTraceOp {
+    MEM_TRACE_ALLOC = 1,   // size = requested size, id = new block
+    MEM_TRACE_FREE = 2,    // id = freed block
+    MEM_TRACE_RESIZE = 3,  // size = new size, id = resized block (kept if it moved)
+    MEM_TRACE_RESET = 4    // mem_init or mem_deinit dropped every live block at once
+} MemTraceOp;
+
+typedef struct MemTraceHeader {
+    uint32_t magic;    // MEM_TRACE_MAGIC
+    uint32_t version;  // MEM_TRACE_VERSION
+} MemTraceHeader;
+
+typedef struct MemTraceRecord {
+    uint64_t timestamp;  // Nanoseconds since the first traced call
+    uint64_t size;       // Requested size, 0 for free
+    uint32_t id;         // Block the call refers to
+    uint8_t op;          // MemTraceOp
+    uint8_t reserved[3];
+} MemTraceRecord;
+
+#endif
@@ -1,281 +1,3886 @@
-#include "memory_manager.h"
-
-// Funktion för att initiera minnespoolen
-void mem_init(size_t size) {
-    // Allokera minnespoolen med angiven storlek
-    memory_pool = malloc(size);
-    if (memory_pool == NULL) {
-        // Felhantering om allokeringen misslyckas
-        printf("Failed to allocate memory pool.\n");
-        return;
-    }
-
-    // Skapa ett första block som representerar hela poolen
-    head_pool = (Block*)malloc(sizeof(Block));
-    if (head_pool == NULL) {
-        // Felhantering om blockallokeringen misslyckas
-        printf("Failed to allocate head block.\n");
-        return;
-    }
-
-    // Initialisera första blocket
-    head_pool->address = memory_pool;  // Blockets adress pekar på början av minnespoolen
-    head_pool->size = size;            // Blockets storlek är lika med hela poolens storlek
-    head_pool->is_free = true;         // Blocket markeras som ledigt
-    head_pool->next = NULL;            // Inget nästa block, eftersom detta är det enda blocket just nu
-}
-
-// Funktion för att allokera minne från poolen
-void* mem_alloc(size_t size) {
-    Block* current = head_pool;  // Börja med första blocket
-
-    // Loopa genom blocken tills ett tillräckligt stort ledigt block hittas
-    while (current != NULL) {
-        if (current->is_free && current->size >= size) {
-            // Om ett ledigt block med tillräcklig storlek hittas, markera det som upptaget
-            current->is_free = false;
-
-            // Om blocket är större än vad som behövs, dela upp det i två block
-            if (current->size > size) {
-                // Skapa ett nytt block för resterande ledigt utrymme
-                Block* new_block = (Block*)malloc(sizeof(Block));
-                new_block->address = current->address + size;  // Adressen är efter det allokerade blocket
-                new_block->size = current->size - size;        // Nytt blockets storlek är resterande utrymme
-                new_block->is_free = true;                     // Det nya blocket är ledigt
-                new_block->next = current->next;               // Nya blocket pekar på nästa block i listan
-
-                // Uppdatera storleken på det allokerade blocket och koppla det nya blocket
-                current->size = size;
-                current->next = new_block;
-            }
-
-            // Returnera adressen till det allokerade blocket
-            return current->address;
-        }
-        current = current->next;  // Gå till nästa block
-    }
-
-    // Om inget passande block hittas, skriv ut ett felmeddelande och returnera NULL
-    printf("No suitable block found.\n");
-    return NULL;
-}
-
-// Funktion för att frigöra ett block
-void mem_free(void* block) {
-    Block* current = head_pool;  // Börja med första blocket
-
-    // Loopa igenom blocken för att hitta det som motsvarar den angivna adressen
-    while (current != NULL) {
-        if (current->address == block) {
-            // Markera blocket som ledigt
-            current->is_free = true;
-
-            // Kontrollera om nästa block också är ledigt och slå ihop dem för att minska fragmentering
-            if (current->next != NULL && current->next->is_free) {
-                current->size += current->next->size;  // Lägg till storleken på nästa block
-                Block* temp = current->next;           // Temporär pekare för att frigöra nästa block
-                current->next = current->next->next;   // Hoppa över nästa block i listan
-                free(temp);                            // Frigör minnet för det hopslagna blocket
-            }
-            return;
-        }
-        current = current->next;  // Gå till nästa block
-    }
-
-    // Om blocket inte hittas, skriv ut ett felmeddelande
-    printf("Block not found.\n");
-}
-
-// Funktion för att ändra storleken på ett allokerat block
-void* mem_resize(void* block, size_t size) {
-    Block* current = head_pool;  // Börja med första blocket
-
-    // Loopa igenom blocken för att hitta det som motsvarar den angivna adressen
-    while (current != NULL) {
-        if (current->address == block) {
-            // Om det nuvarande blocket redan är tillräckligt stort, returnera samma block
-            if (current->size >= size) {
-                return block;
-            }
-
-            // Annars, allokera ett nytt block med den önskade storleken
-            void* new_block = mem_alloc(size);
-            if (new_block == NULL) {
-                return NULL;  // Om allokeringen misslyckas, returnera NULL
-            }
-
-            // Kopiera data från det gamla blocket till det nya
-            memcpy(new_block, block, current->size);
-            mem_free(block);  // Frigör det gamla blocket
-            return new_block; // Returnera adressen till det nya blocket
-        }
-        current = current->next;  // Gå till nästa block
-    }
-
-    // Om blocket inte hittas, skriv ut ett felmeddelande
-    printf("Block not found for resizing.\n");
-    return NULL;
-}
-
-// Funktion för att avinitiera minneshanteraren
-void mem_deinit() {
-    // Frigör minnespoolen
-    free(memory_pool);
-    memory_pool = NULL;
-
-    // Frigör alla block i den länkade listan
-    Block* current = head_pool;
-    while (current != NULL) {
-        Block* temp = current;   // Temporär pekare för att hålla blocket som ska frigöras
-        current = current->next; // Gå till nästa block
-        free(temp);              // Frigör nuvarande block
-    }
-    head_pool = NULL;  // Nollställ head_pool när alla block är frigjorda
-}
-
-
-
-
-
-
-
-
-
-
-
-
-
-
-
-
-
-
-
-
-
-
-/*
-#include "memory_manager.h"
-
-
-
-// Function to initialize the memory pool
-void mem_init(size_t size) {
-    // Allocate the memory pool with the specified size
-    memory_pool = malloc(size);
-    if (memory_pool == NULL) {
-        printf("Failed to allocate memory pool.\n");  // Error handling if allocation fails
-        return;
-    }
-
-    // Create an initial block representing the entire pool
-    head_pool = (Block*)malloc(sizeof(Block));
-    if (head_pool == NULL) {
-        printf("Failed to allocate head block.\n");  // Error handling if block allocation fails
-        return;
-    }
-
-    // Initialize first block
-    head_pool->address = memory_pool;
-    head_pool->size = size;
-    head_pool->is_free = true;  // The block is marked as free
-    head_pool->next = NULL;
-}
-
-// Function to allocate memory from the pool
-void* mem_alloc(size_t size) {
-    Block* current = head_pool;  // Start with first block
-
-    // Loop through the blocks until a large enough free block is found
-    while (current != NULL) {
-        if (current->is_free && current->size >= size) {
-            // If a free block of sufficient size is found, mark it as not free
-            current->is_free = false;
-
-            // If the block is larger than needed, split it into two blocks
-            if (current->size > size) {
-                Block* new_block = (Block*)malloc(sizeof(Block));
-                new_block->address = current->address + size;
-                new_block->size = current->size - size; // New block size is remaining space
-                new_block->is_free = true;  // The new block is free
-                new_block->next = current->next;  // The new block points to the next block in the list
-                // Update the size of the allocated block and associate the new block
-                current->size = size;
-                current->next = new_block;
-            }
-
-            return current->address; // Return the address of the allocated block
-        }
-        current = current->next;  // Go to the next block
-    }
-    // If no matching block is found, print an error message and return NULL
-    printf("No suitable block found.\n");
-    return NULL; 
-}
-
-// Function to free a block
-void mem_free(void* block) {
-    Block* current = head_pool; // Start with first block
-
-     // Loop through the blocks to find the one corresponding to the given address
-    while (current != NULL) {
-        if (current->address == block) {
-            current->is_free = true; // Mark the block as free
-            
-            // Check if the next block is also free and merge them to reduce fragmentation
-            if (current->next != NULL && current->next->is_free) {
-                current->size += current->next->size;  // Add the size of the next block
-                Block* temp = current->next;  // Temporary pointer to free the next block
-                current->next = current->next->next;  // Skip the next block in the list
-                free(temp);  // Free the memory for the merged block
-            }
-            return;
-        }
-        current = current->next;  // Go to the next block
-    }
-    printf("Block not found.\n"); // If the block is not found, print an error message
-}
-
-// Function to resize an allocated block
-void* mem_resize(void* block, size_t size) {
-    Block* current = head_pool;
-
-    // Loop through the blocks to find the one corresponding to the given address
-    while (current != NULL) {
-        if (current->address == block) {
-            // If the current block is already large enough, return the same block
-            if (current->size >= size) {
-                return block;
-            }
-            // Otherwise, allocate a new block of the desired size
-            void* new_block = mem_alloc(size);
-            if (new_block == NULL) {
-                return NULL; // If the allocation fails, return NULL
-            }
-
-            // Copy the data from the old block to the new one
-            memcpy(new_block, block, current->size);
-            mem_free(block);  // Free the old block
-            return new_block;  // Return the address of the new block
-        }
-        current = current->next;  // Go to the next block
-    }
-    printf("Block not found for resizing.\n");  // If the block is not found, print an error message
-    return NULL;
-}
-
-// Function to uninitialize the memory manager
-void mem_deinit() {
-    free(memory_pool); // 
-    memory_pool = NULL;
-
-    // Free all blocks in the linked list
-    Block* current = head_pool;
-    while (current != NULL) {
-        Block* temp = current; // Temporary pointer to hold the block to be freed
-        current = current->next; 
-        free(temp); // Free current block
-    }
-    head_pool = NULL;  // Reset head_pool when all blocks are freed
-}*/
-
+#include "memory_manager.h"
+
+#include <pthread.h>
+#include <sys/mman.h>
+#if defined(__x86_64__)
+#include <immintrin.h>
+#endif
+#include <time.h>
+#include <unistd.h>
+
+#ifdef MEM_TRACE
+#include "mem_trace.h"
+#endif
+
+// Storleksklasser för de segregerade fria listorna. Små storlekar får exakta
+// klasser i steg om SMALL_BIN_STEP byte, större storlekar en klass per tvåpotens.
+// Med TLSF delas varje tvåpotens dessutom i TLSF_SUBCLASSES lika breda klasser, så
+// att klasserna räcker till både de vanliga och de finare klasserna.
+#define SMALL_BIN_STEP 8
+#define SMALL_BIN_LIMIT 128
+#define SMALL_BIN_COUNT (SMALL_BIN_LIMIT / SMALL_BIN_STEP)
+#define SMALL_BIN_LIMIT_LOG2 7
+#define TLSF_SUBCLASS_LOG2 4
+#define TLSF_SUBCLASSES (1 << TLSF_SUBCLASS_LOG2)
+#define NUM_BINS (SMALL_BIN_COUNT + (64 - SMALL_BIN_LIMIT_LOG2) * TLSF_SUBCLASSES)
+#define BIN_BITMAP_WORDS ((NUM_BINS + 63) / 64)
+
+// Max antal block som provas i sökstorlekens egen klass innan vi går vidare
+// till en större klass där alla block garanterat räcker.
+#define BIN_SCAN_LIMIT 8
+
+// Små allokeringar (upp till SMALL_OBJECT_LIMIT byte) delas ut ur trådlokala spann.
+// Ett spann är SPAN_SIZE byte av poolen, justerat mot poolens början, och delas i
+// lika stora objekt av en storleksklass. Tomma spann delas mellan trådarna via en
+// låsfri stack per klass, så låset behövs bara när poolen själv måste delas upp.
+#define SMALL_OBJECT_STEP 16
+#define SMALL_OBJECT_LIMIT 256
+#define SMALL_CLASS_COUNT (SMALL_OBJECT_LIMIT / SMALL_OBJECT_STEP)
+#define SPAN_SHIFT 12
+#define SPAN_SIZE ((size_t)1 << SPAN_SHIFT)
+#define SPAN_MAX_OBJECTS (SPAN_SIZE / SMALL_OBJECT_STEP)
+#define SPAN_BITMAP_WORDS (SPAN_MAX_OBJECTS / 64)
+
+// Trådcacharna används bara i pooler som rymmer ett spann för varje storleksklass
+#define MIN_CACHED_POOL (SPAN_SIZE * SMALL_CLASS_COUNT)
+
+// Små allokeringar som inte går via trådcacharna tas ur delade kornspann. Ett kornspann
+// delas i korn om SMALL_OBJECT_STEP byte, och ett objekt är en följd av lediga korn som
+// hittas genom att skifta och bitskanna spannets bitkarta ett ord i taget. Ett objekt
+// kostar då två bitar per korn i stället för en blockdeskriptor. Kornspann används i
+// pooler som rymmer minst fyra spann, så att ett spann aldrig tar mer än en fjärdedel.
+#define MIN_GRANULE_POOL (SPAN_SIZE * 4)
+
+#if MEM_ALIGNMENT < 16 || (MEM_ALIGNMENT & (MEM_ALIGNMENT - 1)) != 0 || MEM_ALIGNMENT > (1 << SPAN_SHIFT)
+#error "MEM_ALIGNMENT must be a power of two between 16 and SPAN_SIZE"
+#endif
+
+// Storleken på en stor sida. Pooler med stora sidor avrundas och justeras till den.
+#define HUGE_PAGE_SIZE ((size_t)2 << 20)
+
+// Hur många block som lämnas tillbaka mellan varje gång avklingningen av lediga sidor kontrolleras
+#define TRIM_TICK_INTERVAL 256
+
+// Max antal sammanhängande områden som en växande pool kan bestå av. Varje nytt område
+// är minst lika stort som poolen redan är, så gränsen nås aldrig i praktiken.
+#define MAX_POOL_REGIONS 64
+
+// Större förfrågningar kan aldrig uppfyllas, och att avvisa dem direkt gör att
+// avrundningar och utfyllnader inte kan slå runt
+#define MAX_REQUEST_SIZE (SIZE_MAX / 2)
+
+// Minsta storlek på tabellen som hittar upptagna block utifrån deras adress
+#define MIN_TABLE_CAPACITY 64
+
+// Minsta antal blockdeskriptorer i ett förallokerat block av deskriptorer
+#define MIN_DESCRIPTOR_CHUNK 64
+
+// Minsta antal platser i en storleksklass vektorer av fria block
+#define MIN_BIN_CAPACITY 8
+
+// Värdet i Block.free_slot för block som inte ligger i någon storleksklass
+#define NOT_IN_BIN SIZE_MAX
+
+// Antal block som mem_free_batch markerar som lediga innan de slås ihop
+#define FREE_BATCH_CHUNK 256
+
+// Antal objekt i en objektpools första skiva. Skivorna dubblas upp till MAX_SLAB_OBJECTS.
+#define MIN_SLAB_OBJECTS 64
+#define MAX_SLAB_OBJECTS 65536
+
+// Ett sammanhängande förråd av blockdeskriptorer. Förråden länkas ihop så att
+// de kan frigöras på en gång när arenan rivs.
+typedef struct DescriptorChunk {
+    struct DescriptorChunk* next;  // Nästa förråd i kedjan
+    size_t count;                  // Antal deskriptorer i förrådet
+    size_t used;                   // Antal deskriptorer som har delats ut från förrådets början
+    Block blocks[];                // Själva deskriptorerna
+} DescriptorChunk;
+
+// De fria blocken i en storleksklass, som två parallella vektorer. Storlekarna ligger
+// tätt för sig, så en sökning efter ett block som räcker läser bara dem och jämför
+// flera åt gången, utan att hoppa mellan deskriptorerna. Det senast inlagda blocket
+// ligger sist, och ett block som tas bort ersätts av det sista.
+typedef struct FreeBin {
+    size_t* sizes;     // Blockens storlekar
+    Block** blocks;    // Blocken, på samma plats som sina storlekar
+    size_t count;      // Antal fria block i klassen
+    size_t capacity;   // Antal platser i vektorerna
+    size_t largest;    // Största storleken i klassen, om inte largest_stale är satt
+    bool largest_stale; // Det största blocket har tagits bort, så 'largest' kan vara för stor
+} FreeBin;
+
+struct ThreadHeap;
+struct Span;
+
+// Räknare för mem_get_stats. Varje tråd har en uppsättning per arena som bara den själv
+// skriver, så de snabba vägarna slipper dela cachelinjer. Arenan har en egen uppsättning
+// för anrop från trådar utan heap och för heapar vars tråd har avslutats.
+enum {
+    COUNT_ALLOCS,       // Anrop till mem_alloc och mem_alloc_aligned
+    COUNT_FREES,        // Anrop till mem_free
+    COUNT_RESIZES,      // Anrop till mem_resize
+    COUNT_FAILED,       // Allokeringar som returnerade NULL
+    COUNT_SMALL_BYTES,  // Byte i utdelade småobjekt, kan bli negativ i en enskild uppsättning
+    NUM_COUNTERS
+};
+
+// Ett sammanhängande område av poolen. Poolen börjar med ett område och får fler när
+// den växer. Blocken i ett område bildar en egen lista, så block slås bara ihop inom området.
+typedef struct PoolRegion {
+    char* start;               // Områdets första byte
+    size_t size;               // Områdets storlek i byte
+    Block* head;               // Första blocket i området
+    struct Span* span_table;   // En spannbeskrivning per SPAN_SIZE av området
+    void* mapping;             // Början på mmap-området, NULL om området kommer från malloc
+    size_t mapping_size;       // Storleken på mmap-området
+} PoolRegion;
+
+// Ett spann av småobjekt. Beskrivningen ligger i arenans span_table, en post per SPAN_SIZE av poolen.
+typedef struct Span {
+    struct ThreadHeap* owner;   // Tråden som delar ut objekten, NULL om tråden har avslutats (atomisk)
+    struct Span* next;          // Nästa spann i ägarens lista
+    struct Span* prev;          // Föregående spann i ägarens lista
+    Block* block;               // Poolblocket som spannet består av
+    void* free_list;            // Lediga objekt, länkade genom objekten själva (bara ägaren)
+    uint16_t object_size;       // Objektens storlek, 0 om platsen inte är ett spann
+    uint16_t capacity;          // Antal objekt som får plats i spannet
+    uint16_t carved;            // Antal objekt som har delats ut från spannets början
+    uint16_t used;              // Antal objekt som är utdelade just nu
+    bool is_full;               // Spannet ligger i ägarens lista över fulla spann
+    bool is_granular;           // Kornspann som delas av alla trådar under arenans lås
+    struct Span* stack_next;    // Nästa spann i arenans stack av tomma spann (atomisk)
+    uint64_t allocated[SPAN_BITMAP_WORDS];  // En bit per utdelat objekt, i kornspann per upptaget korn
+    uint64_t run_end[SPAN_BITMAP_WORDS];    // Kornspann: en bit på sista kornet i varje objekt
+} Span;
+
+// En tråds egna spann i en arena, en uppsättning per storleksklass
+typedef struct ThreadHeap {
+    MemArena* arena;                      // Arenan som spannen hör till
+    unsigned arena_id;                    // Arenans id när spannen skapades
+    struct ThreadHeap* next;              // Trådens nästa heap, i en annan arena
+    Span* available[SMALL_CLASS_COUNT];   // Spann med lediga objekt
+    Span* full[SMALL_CLASS_COUNT];        // Spann där alla objekt är utdelade
+    struct ThreadHeap* next_in_arena;     // Nästa heap i arenans lista (arenans lås)
+    struct ThreadHeap* prev_in_arena;     // Föregående heap i arenans lista (arenans lås)
+    int64_t counts[NUM_COUNTERS];         // Trådens räknare, skrivs bara av tråden själv
+    char remote_pad[64];                  // Håller kön på en egen cachelinje, skild från trådens fält
+    void* remote_frees;                   // Objekt frigjorda av andra trådar, länkade genom objekten (atomisk)
+} ThreadHeap;
+
+// Värdet i en heaps kö när tråden har avslutats. Andra trådar frigör då under arenans lås.
+#define REMOTE_CLOSED ((void*)1)
+
+// En arena är en självständig pool med egna block, storleksklasser och trådcachar.
+// De globala funktionerna arbetar på standardarenan.
+struct MemArena {
+    pthread_mutex_t lock;      // Skyddar allt utom trådarnas egna spann
+    unsigned id;               // Unikt för varje initiering, så att gamla trådcachar glöms
+    struct MemArena* next;     // Nästa levande arena i arena_list
+
+    MemOptions options;        // Alternativen som arenan skapades med
+    void* user_data;           // Anroparens pekare, se mem_arena_set_user_data
+    PoolRegion regions[MAX_POOL_REGIONS];  // Poolens områden i den ordning de skapades
+    size_t region_count;       // Antal områden; läses utan lås, så ett område ändras aldrig efter att det räknats in
+    size_t pool_size;          // Summan av alla områdens storlek
+    MemBacking backing;        // Hur poolens första område faktiskt fick sitt minne
+    size_t page_size;          // Minsta enhet som kan lämnas tillbaka till operativsystemet
+    uint64_t last_trim;        // Tidpunkt (ms) då lediga block senast lämnades tillbaka automatiskt
+    unsigned trim_ticks;       // Antal frigjorda block sedan avklingningen senast kontrollerades
+    size_t free_bytes;         // Summan av alla lediga block i poolen
+
+    bool caches_enabled;       // Om små allokeringar går via trådcacharna
+    bool granules_enabled;     // Om områdena har spannbeskrivningar, så att kornspann kan skapas
+    Span* granule_spans;       // Alla kornspann, senast använda först
+    ThreadHeap* heaps;         // Alla trådars heapar i arenan, så att deras räknare kan summeras
+    ThreadHeap* retired_heaps; // Heapar vars tråd har avslutats, återanvänds av nya trådar
+    uint64_t span_stacks[SMALL_CLASS_COUNT];  // Tomma spann per storleksklass, låsfria stackar
+
+    int64_t counts[NUM_COUNTERS];  // Räknare för anrop utan egen heap, uppdateras atomiskt
+    size_t free_blocks;        // Antal block i storleksklasserna
+    size_t span_bytes;         // Byte i poolblock som används som spann
+    size_t buddy_slack;        // Byte som upptagna block har avrundats uppåt med buddy-placering
+    uint64_t searches;         // Antal sökningar efter ett fritt block
+    uint64_t search_steps;     // Antal fria block som sökningarna har tittat på
+    size_t max_search;         // Flest fria block som en enda sökning har tittat på
+
+    FreeBin free_bins[NUM_BINS];            // Fria block, en vektor per storleksklass
+    uint64_t bin_bitmap[BIN_BITMAP_WORDS];  // En bit per klass som inte är tom
+    uint64_t bin_summary;                   // En bit per ord i bin_bitmap som inte är noll
+    bool scan_avx2;                         // Om processorn har AVX2, läst en gång när arenan skapas
+    Block* size_tree;                       // Fria block ordnade efter storlek, vid bästa passning
+    Block* rover;                           // Där nästa sökning börjar vid nästa passning, NULL för områdets början
+    size_t rover_region;                    // Området som 'rover' ligger i
+
+    DescriptorChunk* descriptor_chunks;  // Alla förråd av deskriptorer
+    Block* free_descriptors;             // Oanvända deskriptorer, länkade via 'next'
+    size_t next_chunk_count;             // Storlek på nästa förråd som skapas
+
+    size_t* marks;             // Öppna kontrollpunkter från mem_mark, som positioner i mark_log
+    size_t mark_count;         // Antal öppna kontrollpunkter; läses utan lås
+    size_t mark_capacity;      // Antal platser i 'marks'
+    void** mark_log;           // Block som har allokerats sedan den äldsta öppna kontrollpunkten
+    size_t mark_log_count;     // Antal adresser i mark_log
+    size_t mark_log_capacity;  // Antal platser i mark_log
+
+    MemHandle* handles;        // Alla levande handtag, så att de kan frigöras när arenan töms
+
+    void** zero_blocks;        // Adresser från allokeringar på noll byte som inte har frigjorts
+    size_t zero_count;         // Antal adresser i zero_blocks; läses utan lås
+    size_t zero_capacity;      // Antal platser i zero_blocks
+    MemHandle* compact_cursor; // Handtaget vars block kompakteringen fortsätter efter, NULL från områdets början
+    size_t compact_region;     // Området som kompakteringen arbetar i
+
+    Block** block_table;       // Upptagna block, öppen adressering med adressen som nyckel
+    size_t table_capacity;     // Antal platser i tabellen (alltid en tvåpotens)
+    size_t table_count;        // Antal block i tabellen
+    int table_shift;           // 64 - log2(table_capacity), används av hashfunktionen
+};
+
+static MemArena default_arena = {.lock = PTHREAD_MUTEX_INITIALIZER};  // Arenan bakom mem_init och mem_alloc
+
+// En pool av objekt med samma storlek. Objekten delas ut ur skivor som allokeras ur en
+// arena, så allokering och frigöring är bara att ta från eller lägga på en fri lista.
+struct MemObjectPool {
+    MemArena* arena;           // Arenan som skivorna allokeras ur
+    size_t stride;             // Avståndet mellan två objekt
+    size_t align;              // Justeringen av skivorna och därmed objekten
+    void* free_list;           // Frigjorda objekt, länkade genom objekten själva
+    char* carve;               // Nästa objekt som aldrig har delats ut i den senaste skivan
+    char* carve_end;           // Slutet på den senaste skivan
+    void** slabs;              // Alla skivor, så att de kan lämnas tillbaka
+    size_t slab_count;         // Antal skivor
+    size_t slab_capacity;      // Antal platser i 'slabs'
+    size_t next_slab_objects;  // Antal objekt i nästa skiva
+};
+
+// Ett flyttbart block. Handtaget ligger kvar på samma adress när blocket flyttas, och
+// blocket hålls utanför adresstabellen så att det bara nås via handtaget.
+struct MemHandle {
+    MemArena* arena;           // Arenan som blocket ligger i
+    Block* block;              // Blocket, vars adress ändras när det flyttas
+    unsigned lock_count;       // Antal lås som inte har släppts; ett låst block flyttas inte
+    struct MemHandle* next;    // Nästa handtag i arenans lista
+    struct MemHandle* prev;    // Föregående handtag i arenans lista
+};
+
+static pthread_mutex_t arena_list_lock = PTHREAD_MUTEX_INITIALIZER;  // Skyddar arena_list
+static MemArena* arena_list;       // Alla initierade arenor
+static unsigned next_arena_id;     // Räknas upp för varje arena som initieras
+
+static pthread_key_t heap_key;     // Ger en destruktor för trådens heapar när tråden avslutas
+static pthread_once_t heap_key_once = PTHREAD_ONCE_INIT;
+static __thread ThreadHeap* thread_heaps;  // Den anropande trådens heapar, senast använda först
+
+// Funktion för att lägga till ett nytt förråd av deskriptorer
+static bool descriptor_grow(MemArena* arena) {
+    size_t count = arena->next_chunk_count;
+    DescriptorChunk* chunk = (DescriptorChunk*)malloc(sizeof(DescriptorChunk) + count * sizeof(Block));
+    if (chunk == NULL) {
+        return false;
+    }
+    chunk->next = arena->descriptor_chunks;
+    chunk->count = count;
+    chunk->used = 0;  // Deskriptorerna delas ut i adressordning när de behövs
+    arena->descriptor_chunks = chunk;
+
+    // Nästa förråd blir dubbelt så stort, men aldrig större än MAX_BLOCKS
+    arena->next_chunk_count = count * 2 < MAX_BLOCKS ? count * 2 : MAX_BLOCKS;
+    return true;
+}
+
+// Funktion för att hämta en oanvänd deskriptor
+static Block* descriptor_alloc(MemArena* arena) {
+    // Återlämnade deskriptorer används först
+    Block* block = arena->free_descriptors;
+    if (block != NULL) {
+        arena->free_descriptors = block->next;
+    } else {
+        // Annars tas nästa aldrig använda deskriptor i det senaste förrådet
+        DescriptorChunk* chunk = arena->descriptor_chunks;
+        if (chunk == NULL || chunk->used == chunk->count) {
+            if (!descriptor_grow(arena)) {
+                return NULL;
+            }
+            chunk = arena->descriptor_chunks;
+        }
+        block = &chunk->blocks[chunk->used++];
+    }
+    block->handle = NULL;  // Bara block som allokeras via ett handtag får flyttas
+    block->slack = 0;
+    block->free_slot = NOT_IN_BIN;
+    return block;
+}
+
+// Funktion för att lämna tillbaka en deskriptor till förrådet
+static void descriptor_free(MemArena* arena, Block* block) {
+    // Deskriptorn har slagits ihop med blocket före, så sökningen fortsätter därifrån
+    if (arena->rover == block) {
+        arena->rover = block->prev;
+    }
+    block->next = arena->free_descriptors;
+    arena->free_descriptors = block;
+}
+
+// Funktion för att räkna ut första platsen i tabellen för en adress
+static size_t table_slot(MemArena* arena, void* address) {
+    // Fibonacci-hashning sprider närliggande adresser över hela tabellen
+    return (size_t)(((uint64_t)(uintptr_t)address * 0x9E3779B97F4A7C15ULL) >> arena->table_shift);
+}
+
+// Funktion för att skapa en tom tabell med plats för 'capacity' block
+static bool table_create(MemArena* arena, size_t capacity) {
+    Block** table = (Block**)calloc(capacity, sizeof(Block*));
+    if (table == NULL) {
+        return false;
+    }
+    arena->block_table = table;
+    arena->table_capacity = capacity;
+    arena->table_count = 0;
+    arena->table_shift = 64 - __builtin_ctzll(capacity);
+    return true;
+}
+
+// Funktion för att lägga in ett block på första lediga plats efter dess hashplats
+static void table_put(MemArena* arena, Block* block) {
+    size_t mask = arena->table_capacity - 1;
+    size_t slot = table_slot(arena, block->address);
+    while (arena->block_table[slot] != NULL) {
+        slot = (slot + 1) & mask;  // Linjär sondering
+    }
+    arena->block_table[slot] = block;
+    arena->table_count++;
+}
+
+// Funktion för att se till att 'count' block till får plats i tabellen. Tabellen
+// dubblas när den skulle bli mer än halvfull. En arena utan pool får ingen tabell.
+static bool table_reserve(MemArena* arena, size_t count) {
+    if ((arena->table_count + count) * 2 <= arena->table_capacity) {
+        return true;
+    }
+    if (arena->region_count == 0) {
+        return false;
+    }
+
+    // Tabellen saknas om den inte kunde skapas när arenan initierades
+    Block** old_table = arena->block_table;
+    size_t old_capacity = arena->table_capacity;
+    size_t capacity = old_capacity > 0 ? old_capacity * 2 : MIN_TABLE_CAPACITY;
+    while ((arena->table_count + count) * 2 > capacity) {
+        capacity *= 2;
+    }
+    if (!table_create(arena, capacity)) {
+        return false;  // Den gamla tabellen används vidare
+    }
+
+    // Flytta över alla block till den nya tabellen
+    for (size_t i = 0; i < old_capacity; i++) {
+        if (old_table[i] != NULL) {
+            table_put(arena, old_table[i]);
+        }
+    }
+    free(old_table);
+    return true;
+}
+
+// Funktion för att hitta platsen för blocket som börjar på 'address'.
+// Returnerar table_capacity om blocket inte finns i tabellen.
+static size_t table_find(MemArena* arena, void* address) {
+    size_t mask = arena->table_capacity - 1;
+    size_t slot = table_slot(arena, address);
+    while (arena->block_table[slot] != NULL) {
+        if (arena->block_table[slot]->address == address) {
+            return slot;
+        }
+        slot = (slot + 1) & mask;
+    }
+    return arena->table_capacity;  // Ingen träff
+}
+
+// Funktion för att ta bort blocket som börjar på 'address' och returnera det
+static Block* table_take(MemArena* arena, void* address) {
+    if (arena->block_table == NULL) {
+        return NULL;
+    }
+    size_t slot = table_find(arena, address);
+    if (slot == arena->table_capacity) {
+        return NULL;
+    }
+
+    Block** table = arena->block_table;
+    Block* found = table[slot];
+    size_t mask = arena->table_capacity - 1;
+    size_t hole = slot;
+
+    // Flytta bakåt de efterföljande blocken som annars inte längre skulle hittas
+    for (size_t next = (hole + 1) & mask; table[next] != NULL; next = (next + 1) & mask) {
+        size_t home = table_slot(arena, table[next]->address);
+        // Blocket får flyttas till hålet om hålet ligger mellan dess hemplats och nuvarande plats
+        if (((next - home) & mask) >= ((next - hole) & mask)) {
+            table[hole] = table[next];
+            hole = next;
+        }
+    }
+    table[hole] = NULL;
+    arena->table_count--;
+    return found;
+}
+
+// Funktion för att slå upp blocket som börjar på 'address'
+static Block* table_get(MemArena* arena, void* address) {
+    if (arena->block_table == NULL) {
+        return NULL;
+    }
+    size_t slot = table_find(arena, address);
+    return slot == arena->table_capacity ? NULL : arena->block_table[slot];
+}
+
+// Funktion för att räkna ut vilken storleksklass en storlek hör till. Med TLSF väljer
+// de närmast högsta bitarna dessutom en av tvåpotensens underklasser.
+static size_t size_to_bin(MemArena* arena, size_t size) {
+    if (size < SMALL_BIN_LIMIT) {
+        return size / SMALL_BIN_STEP;
+    }
+    size_t log2 = 63 - __builtin_clzll(size);  // Position för högsta satta biten
+    if (arena->options.placement == MEM_PLACEMENT_TLSF) {
+        size_t sub = (size >> (log2 - TLSF_SUBCLASS_LOG2)) & (TLSF_SUBCLASSES - 1);
+        return SMALL_BIN_COUNT + (log2 - SMALL_BIN_LIMIT_LOG2) * TLSF_SUBCLASSES + sub;
+    }
+    return SMALL_BIN_COUNT + (log2 - SMALL_BIN_LIMIT_LOG2);
+}
+
+// Funktion för att avrunda en storlek uppåt till standardjusteringen. Block delas av
+// vid avrundade storlekar, så alla block utom det sista i poolen blir multiplar av
+// MEM_ALIGNMENT och alla block börjar därför på justerade adresser.
+static size_t align_up(size_t size) {
+    return (size + MEM_ALIGNMENT - 1) & ~(size_t)(MEM_ALIGNMENT - 1);
+}
+
+// Trädet för bästa passning ordnar de lediga blocken efter storlek och sedan adress.
+// Det är en treap: varje nod får en prioritet räknad ur deskriptorns adress, och en nod
+// ligger alltid över noder med lägre prioritet, vilket håller trädet balanserat i förväntan.
+static uint64_t tree_priority(Block* block) {
+    // Deskriptorerna ligger med jämna avstånd, så adressen blandas om helt; en enda
+    // multiplikation ger prioriteter i en regelbunden följd som kan obalansera trädet
+    uint64_t x = (uint64_t)(uintptr_t)block;
+    x = (x ^ (x >> 33)) * 0xFF51AFD7ED558CCDULL;
+    x = (x ^ (x >> 33)) * 0xC4CEB9FE1A85EC53ULL;
+    return x ^ (x >> 33);
+}
+
+// Funktion för att avgöra om block 'a' kommer före block 'b' i trädet
+static bool tree_less(Block* a, Block* b) {
+    return a->size < b->size || (a->size == b->size && (uintptr_t)a->address < (uintptr_t)b->address);
+}
+
+// Funktion för att lägga in ett block i ett delträd. Returnerar delträdets nya rot.
+static Block* tree_insert(Block* root, Block* block) {
+    if (root == NULL) {
+        block->tree_left = NULL;
+        block->tree_right = NULL;
+        return block;
+    }
+    if (tree_less(block, root)) {
+        root->tree_left = tree_insert(root->tree_left, block);
+        if (tree_priority(root->tree_left) > tree_priority(root)) {
+            // Rotera åt höger så att det nya blocket hamnar över roten
+            Block* left = root->tree_left;
+            root->tree_left = left->tree_right;
+            left->tree_right = root;
+            return left;
+        }
+    } else {
+        root->tree_right = tree_insert(root->tree_right, block);
+        if (tree_priority(root->tree_right) > tree_priority(root)) {
+            Block* right = root->tree_right;
+            root->tree_right = right->tree_left;
+            right->tree_left = root;
+            return right;
+        }
+    }
+    return root;
+}
+
+// Funktion för att foga ihop två delträd där alla block i 'left' kommer före 'right'
+static Block* tree_join(Block* left, Block* right) {
+    if (left == NULL) {
+        return right;
+    }
+    if (right == NULL) {
+        return left;
+    }
+    if (tree_priority(left) > tree_priority(right)) {
+        left->tree_right = tree_join(left->tree_right, right);
+        return left;
+    }
+    right->tree_left = tree_join(left, right->tree_left);
+    return right;
+}
+
+// Funktion för att ta bort ett block ur ett delträd. Returnerar delträdets nya rot.
+static Block* tree_remove(Block* root, Block* block) {
+    if (root == block) {
+        return tree_join(root->tree_left, root->tree_right);
+    }
+    if (tree_less(block, root)) {
+        root->tree_left = tree_remove(root->tree_left, block);
+    } else {
+        root->tree_right = tree_remove(root->tree_right, block);
+    }
+    return root;
+}
+
+// Funktion för att ge en storleksklass plats för fler block. Returnerar false om minnet tog slut.
+static bool bin_grow(FreeBin* free_bin) {
+    size_t capacity = free_bin->capacity > 0 ? free_bin->capacity * 2 : MIN_BIN_CAPACITY;
+    size_t* sizes = (size_t*)realloc(free_bin->sizes, capacity * sizeof(size_t));
+    if (sizes == NULL) {
+        return false;
+    }
+    free_bin->sizes = sizes;
+    Block** blocks = (Block**)realloc(free_bin->blocks, capacity * sizeof(Block*));
+    if (blocks == NULL) {
+        return false;
+    }
+    free_bin->blocks = blocks;
+    free_bin->capacity = capacity;
+    return true;
+}
+
+// Funktion för att tömma alla storleksklasser. Med 'release' frigörs också vektorerna,
+// annars behålls de för att fyllas på igen.
+static void bins_clear(MemArena* arena, bool release) {
+    for (size_t bin = 0; bin < NUM_BINS; bin++) {
+        if (release) {
+            free(arena->free_bins[bin].sizes);
+            free(arena->free_bins[bin].blocks);
+            memset(&arena->free_bins[bin], 0, sizeof(FreeBin));
+        }
+        arena->free_bins[bin].count = 0;
+        arena->free_bins[bin].largest = 0;
+        arena->free_bins[bin].largest_stale = false;
+    }
+    memset(arena->bin_bitmap, 0, sizeof(arena->bin_bitmap));
+    arena->bin_summary = 0;
+}
+
+// Funktion för att hämta det senast inlagda blocket i en storleksklass, eller NULL om den är tom
+static Block* bin_newest(MemArena* arena, size_t bin) {
+    FreeBin* free_bin = &arena->free_bins[bin];
+    return free_bin->count > 0 ? free_bin->blocks[free_bin->count - 1] : NULL;
+}
+
+// Funktion för att lägga in ett fritt block sist i sin storleksklass. Går vektorn inte
+// att utöka förblir blocket ledigt och slås ihop med sina grannar, men väljs inte förrän dess.
+static void bin_insert(MemArena* arena, Block* block) {
+    size_t bin = size_to_bin(arena, block->size);
+    FreeBin* free_bin = &arena->free_bins[bin];
+    if (free_bin->count == free_bin->capacity && !bin_grow(free_bin)) {
+        printf("Failed to grow free list.\n");
+        return;
+    }
+
+    block->free_slot = free_bin->count;
+    free_bin->sizes[free_bin->count] = block->size;
+    free_bin->blocks[free_bin->count] = block;
+    free_bin->count++;
+    if (block->size >= free_bin->largest) {
+        free_bin->largest = block->size;  // Inget block i klassen är större
+        free_bin->largest_stale = false;
+    }
+    arena->bin_bitmap[bin / 64] |= 1ULL << (bin % 64);  // Klassen är inte längre tom
+    arena->bin_summary |= 1ULL << (bin / 64);
+    arena->free_blocks++;
+    if (arena->options.placement == MEM_PLACEMENT_BEST_FIT) {
+        arena->size_tree = tree_insert(arena->size_tree, block);
+    }
+}
+
+// Funktion för att ta bort ett block ur sin storleksklass. Det sista blocket i klassen
+// flyttas till den lediga platsen, så att vektorerna förblir täta.
+static void bin_remove(MemArena* arena, Block* block) {
+    if (block->free_slot == NOT_IN_BIN) {
+        return;  // Blocket fick aldrig plats i sin klass
+    }
+    size_t bin = size_to_bin(arena, block->size);
+    FreeBin* free_bin = &arena->free_bins[bin];
+
+    size_t last = --free_bin->count;
+    free_bin->sizes[block->free_slot] = free_bin->sizes[last];
+    free_bin->blocks[block->free_slot] = free_bin->blocks[last];
+    free_bin->blocks[block->free_slot]->free_slot = block->free_slot;
+    block->free_slot = NOT_IN_BIN;
+    if (block->size == free_bin->largest) {
+        free_bin->largest_stale = true;  // Räknas om först när den behövs, se largest_free
+    }
+    if (free_bin->count == 0) {
+        free_bin->largest = 0;
+        free_bin->largest_stale = false;
+        arena->bin_bitmap[bin / 64] &= ~(1ULL << (bin % 64));  // Klassen blev tom
+        if (arena->bin_bitmap[bin / 64] == 0) {
+            arena->bin_summary &= ~(1ULL << (bin / 64));
+        }
+    }
+    arena->free_blocks--;
+    if (arena->options.placement == MEM_PLACEMENT_BEST_FIT) {
+        arena->size_tree = tree_remove(arena->size_tree, block);
+    }
+}
+
+// Funktion för att hitta första icke-tomma klassen från och med 'from'. Sammanfattningen
+// pekar ut nästa ord med en satt bit, så det räcker med två bitsökningar.
+static size_t find_next_bin(MemArena* arena, size_t from) {
+    if (from >= NUM_BINS) {
+        return NUM_BINS;
+    }
+    size_t word = from / 64;
+    uint64_t bits = arena->bin_bitmap[word] & (~0ULL << (from % 64));  // Maska bort klasser under 'from'
+    if (bits == 0) {
+        uint64_t words = arena->bin_summary & (~0ULL << word) & ~(1ULL << word);
+        if (words == 0) {
+            return NUM_BINS;  // Alla klasser från 'from' och uppåt är tomma
+        }
+        word = __builtin_ctzll(words);
+        bits = arena->bin_bitmap[word];
+    }
+    return word * 64 + __builtin_ctzll(bits);
+}
+
+// Funktion för att hitta den högsta icke-tomma klassen
+static size_t find_last_bin(MemArena* arena) {
+    if (arena->bin_summary == 0) {
+        return NUM_BINS;  // Inga lediga block alls
+    }
+    size_t word = 63 - __builtin_clzll(arena->bin_summary);
+    return word * 64 + 63 - __builtin_clzll(arena->bin_bitmap[word]);
+}
+
+// Funktion för att räkna in en sökning som tittade på 'steps' fria block
+static void record_search(MemArena* arena, size_t steps) {
+    arena->searches++;
+    arena->search_steps += steps;
+    if (steps > arena->max_search) {
+        arena->max_search = steps;
+    }
+}
+
+// Funktion för att hitta det minsta fria blocket som rymmer 'size' byte i trädet för
+// bästa passning. Bland lika stora block vinner det med lägst adress.
+static Block* find_best_fit(MemArena* arena, size_t size) {
+    Block* best = NULL;
+    size_t steps = 0;
+    for (Block* node = arena->size_tree; node != NULL; steps++) {
+        if (node->size >= size) {
+            best = node;
+            node = node->tree_left;  // Det kan finnas ett mindre block som också räcker
+        } else {
+            node = node->tree_right;
+        }
+    }
+    record_search(arena, steps);
+    return best;
+}
+
+// Funktion för att hitta nästa fria block som rymmer 'size' byte, med början där förra
+// sökningen slutade. Blocken gås igenom i adressordning och sökningen fortsätter i nästa
+// område, och till sist från poolens början, tills den är tillbaka där den började.
+static Block* find_next_fit(MemArena* arena, size_t size) {
+    if (arena->rover_region >= arena->region_count) {
+        arena->rover = NULL;
+        arena->rover_region = 0;
+    }
+    size_t region = arena->rover_region;
+    Block* start = arena->rover != NULL ? arena->rover : arena->regions[region].head;
+    Block* current = start;
+    size_t steps = 0;
+    do {
+        steps++;
+        if (current->is_free && current->size >= size) {
+            arena->rover = current;
+            arena->rover_region = region;
+            record_search(arena, steps);
+            return current;
+        }
+        current = current->next;
+        if (current == NULL) {
+            region = (region + 1) % arena->region_count;
+            current = arena->regions[region].head;
+        }
+    } while (current != start);
+    record_search(arena, steps);
+    return NULL;
+}
+
+// Funktion för att hitta ett fritt block som rymmer 'size' byte med TLSF. Storleken
+// avrundas uppåt till nästa klassgräns, så att varje block i den första icke-tomma
+// klassen därifrån räcker. Finns ingen sådan prövas bara det första blocket i storlekens
+// egen klass, så sökningen tar lika lång tid hur poolen än ser ut.
+static Block* find_good_fit(MemArena* arena, size_t size) {
+    size_t width = SMALL_BIN_STEP;
+    if (size >= SMALL_BIN_LIMIT) {
+        width = (size_t)1 << (63 - __builtin_clzll(size) - TLSF_SUBCLASS_LOG2);
+    }
+    size_t bin = find_next_bin(arena, size_to_bin(arena, size + width - 1));
+    if (bin < NUM_BINS) {
+        record_search(arena, 1);
+        return bin_newest(arena, bin);
+    }
+    Block* head = bin_newest(arena, size_to_bin(arena, size));
+    record_search(arena, 2);
+    return head != NULL && head->size >= size ? head : NULL;
+}
+
+// Funktion för att hitta det senast inlagda blocket på minst 'size' byte bland platserna
+// 'low' till 'high' (exklusive) i en storleksklass, med AVX2. Fyra storlekar jämförs
+// åt gången; storlekarna är under 2^63, så en jämförelse med tecken räcker. Bara på
+// x86-64, där size_t är 64 bitar brett som vektorns fält.
+#if defined(__x86_64__)
+__attribute__((target("avx2")))
+static size_t bin_scan_avx2(const size_t* sizes, size_t low, size_t high, size_t size) {
+    __m256i needed = _mm256_set1_epi64x((long long)size - 1);
+    while (high - low >= 4) {
+        __m256i chunk = _mm256_loadu_si256((const __m256i*)(sizes + high - 4));
+        int fits = _mm256_movemask_pd(_mm256_castsi256_pd(_mm256_cmpgt_epi64(chunk, needed)));
+        if (fits != 0) {
+            return high - 4 + (size_t)(31 - __builtin_clz((unsigned)fits));
+        }
+        high -= 4;
+    }
+    while (high > low) {
+        high--;
+        if (sizes[high] >= size) {
+            return high;
+        }
+    }
+    return NOT_IN_BIN;
+}
+#endif
+
+// Funktion för att hitta det senast inlagda blocket på minst 'size' byte bland platserna
+// 'low' till 'high' (exklusive) i en storleksklass. Returnerar platsen, eller NOT_IN_BIN.
+static size_t bin_scan(MemArena* arena, const FreeBin* free_bin, size_t low, size_t high, size_t size) {
+#if defined(__x86_64__)
+    if (high - low >= 8 && arena->scan_avx2) {
+        return bin_scan_avx2(free_bin->sizes, low, high, size);
+    }
+#endif
+    while (high > low) {
+        high--;
+        if (free_bin->sizes[high] >= size) {
+            return high;
+        }
+    }
+    return NOT_IN_BIN;
+}
+
+// Funktion för att hitta ett fritt block som rymmer 'size' byte
+static Block* find_free_block(MemArena* arena, size_t size) {
+    if (arena->options.placement == MEM_PLACEMENT_TLSF) {
+        return find_good_fit(arena, size);
+    }
+    if (arena->options.placement == MEM_PLACEMENT_BEST_FIT) {
+        return find_best_fit(arena, size);
+    }
+    if (arena->options.placement == MEM_PLACEMENT_NEXT_FIT) {
+        return find_next_fit(arena, size);
+    }
+    size_t bin = size_to_bin(arena, size);
+    FreeBin* own = &arena->free_bins[bin];
+
+    // Prova ett begränsat antal block i den egna klassen, där storlekarna kan vara för små
+    size_t recent = own->count > BIN_SCAN_LIMIT ? own->count - BIN_SCAN_LIMIT : 0;
+    size_t slot = bin_scan(arena, own, recent, own->count, size);
+    if (slot != NOT_IN_BIN) {
+        record_search(arena, own->count - slot);
+        return own->blocks[slot];
+    }
+
+    // Alla block i en större klass räcker, så det första duger
+    size_t next_bin = find_next_bin(arena, bin + 1);
+    if (next_bin < NUM_BINS) {
+        record_search(arena, own->count - recent + 1);
+        return bin_newest(arena, next_bin);
+    }
+
+    // Sista utvägen: gå igenom resten av den egna klassen
+    slot = bin_scan(arena, own, 0, recent, size);
+    if (slot != NOT_IN_BIN) {
+        record_search(arena, own->count - slot);
+        return own->blocks[slot];
+    }
+    record_search(arena, own->count);
+    return NULL;
+}
+
+// Funktion för att hitta storleken på det största lediga blocket. Det ligger i den
+// högsta icke-tomma klassen, vars största storlek hålls aktuell när block läggs in. Bara
+// om klassens största block har tagits bort sedan sist läses klassens storlekar igen.
+static size_t largest_free(MemArena* arena) {
+    size_t bin = find_last_bin(arena);
+    if (bin >= NUM_BINS) {
+        return 0;
+    }
+    FreeBin* free_bin = &arena->free_bins[bin];
+    if (free_bin->largest_stale) {
+        size_t largest = 0;
+        for (size_t slot = 0; slot < free_bin->count; slot++) {
+            if (free_bin->sizes[slot] > largest) {
+                largest = free_bin->sizes[slot];
+            }
+        }
+        free_bin->largest = largest;
+        free_bin->largest_stale = false;
+    }
+    return free_bin->largest;
+}
+
+// Funktion för att hitta ett fritt block där 'size' byte får plats på en adress som
+// är en multipel av 'align'. Går igenom alla klasser som kan räcka, så den används
+// bara när den snabba sökningen inte hittar något.
+static Block* find_aligned_block(MemArena* arena, size_t size, size_t align) {
+    size_t steps = 0;
+    for (size_t bin = find_next_bin(arena, size_to_bin(arena, size)); bin < NUM_BINS; bin = find_next_bin(arena, bin + 1)) {
+        FreeBin* free_bin = &arena->free_bins[bin];
+        for (size_t slot = free_bin->count; slot-- > 0;) {
+            Block* current = free_bin->blocks[slot];
+            steps++;
+            size_t pad = (align - (uintptr_t)current->address % align) % align;
+            if (current->size >= pad && current->size - pad >= size) {
+                record_search(arena, steps);
+                return current;
+            }
+        }
+    }
+    record_search(arena, steps);
+    return NULL;
+}
+
+// Funktion för att dela av slutet på ett upptaget block till ett nytt fritt block.
+// Blocket behåller 'size' byte och resten läggs i sin storleksklass.
+// Returnerar false och lämnar blocket orört om ingen deskriptor finns att få.
+static bool split_block(MemArena* arena, Block* current, size_t size) {
+    // Skapa ett nytt block för resterande ledigt utrymme
+    Block* new_block = descriptor_alloc(arena);
+    if (new_block == NULL) {
+        return false;
+    }
+    new_block->address = (char*)current->address + size;  // Adressen är efter det allokerade blocket
+    new_block->size = current->size - size;                // Nytt blockets storlek är resterande utrymme
+    new_block->is_free = true;                             // Det nya blocket är ledigt
+    new_block->is_purged = current->is_purged;             // Resten av ett tömt block är fortfarande tömd
+    new_block->freed_at = current->freed_at;
+    new_block->next = current->next;                       // Nya blocket pekar på nästa block i listan
+    new_block->prev = current;                             // och bakåt på det allokerade blocket
+    if (current->next != NULL) {
+        current->next->prev = new_block;
+    }
+
+    // Uppdatera storleken på det allokerade blocket och koppla det nya blocket
+    current->size = size;
+    current->next = new_block;
+
+    // Om blocket efter är ledigt (vid krympning) slås resten ihop med det. Med
+    // buddy-placering är resten en egen kompis och får inte växa.
+    Block* next = new_block->next;
+    if (next != NULL && next->is_free && arena->options.placement != MEM_PLACEMENT_BUDDY) {
+        bin_remove(arena, next);
+        new_block->size += next->size;
+        new_block->is_purged = new_block->is_purged && next->is_purged;
+        new_block->freed_at = next->freed_at > new_block->freed_at ? next->freed_at : new_block->freed_at;
+        new_block->next = next->next;
+        if (next->next != NULL) {
+            next->next->prev = new_block;
+        }
+        descriptor_free(arena, next);
+    }
+    bin_insert(arena, new_block);  // Resten blir ett fritt block i sin storleksklass
+    return true;
+}
+
+// Funktion för att räkna ut blockstorleken för en begäran med buddy-placering: den
+// minsta tvåpotensen som rymmer både den avrundade storleken och justeringen
+static size_t buddy_size(size_t size, size_t align) {
+    size_t need = align_up(size) > align ? align_up(size) : align;
+    return need <= MEM_ALIGNMENT ? MEM_ALIGNMENT : (size_t)1 << (64 - __builtin_clzll(need - 1));
+}
+
+// Funktion för att lägga in ett nytt områdes enda fria block i storleksklasserna. Med
+// buddy-placering delas det först i tvåpotenser, största först, så att varje bit
+// börjar på en multipel av sin storlek räknat från områdets början.
+static void region_insert(MemArena* arena, Block* head) {
+    Block* current = head;
+    while (arena->options.placement == MEM_PLACEMENT_BUDDY && (current->size & (current->size - 1)) != 0 &&
+           split_block(arena, current, (size_t)1 << (63 - __builtin_clzll(current->size)))) {
+        bin_insert(arena, current);
+        current = current->next;
+        bin_remove(arena, current);
+    }
+    bin_insert(arena, current);
+}
+
+// Funktion för att ta ett block ur poolen med buddy-placering. Den minsta icke-tomma
+// klassen som räcker hittas direkt i bitmappen, och blocket halveras sedan tills det
+// har rätt storlek; de övre halvorna blir lediga kompisar. Anroparen håller arenans lås.
+static Block* buddy_alloc(MemArena* arena, size_t size, size_t align) {
+    size_t need = buddy_size(size, align);
+    size_t bin = find_next_bin(arena, size_to_bin(arena, need));
+    record_search(arena, 1);
+    if (bin == NUM_BINS) {
+        return NULL;
+    }
+    Block* current = bin_newest(arena, bin);
+    if ((uintptr_t)current->address % align != 0) {
+        return NULL;  // Justeringen är större än områdets, så ingen kompis räcker
+    }
+    bin_remove(arena, current);
+    current->is_free = false;
+    while (current->size > need && split_block(arena, current, current->size / 2)) {
+    }
+    current->is_purged = false;
+    arena->free_bytes -= current->size;
+    current->slack = current->size - align_up(size);
+    arena->buddy_slack += current->slack;
+    return current;
+}
+
+// Funktion för att ta ett block på 'size' byte ur poolen, med en adress som är en
+// multipel av 'align'. Anroparen håller arenans lås.
+static Block* block_alloc(MemArena* arena, size_t size, size_t align) {
+    if (arena->options.placement == MEM_PLACEMENT_BUDDY) {
+        return buddy_alloc(arena, size, align);
+    }
+    // Ett block som är 'align - 1' byte större räcker alltid, oavsett var det börjar
+    Block* current = find_free_block(arena, size + align - 1);
+    if (current == NULL && align > 1) {
+        current = find_aligned_block(arena, size, align);
+    }
+    if (current == NULL) {
+        return NULL;
+    }
+    bin_remove(arena, current);
+
+    // Dela av början av blocket som ett eget fritt block om adressen inte är justerad
+    size_t pad = (align - (uintptr_t)current->address % align) % align;
+    if (pad > 0) {
+        Block* rest = descriptor_alloc(arena);
+        if (rest == NULL) {
+            bin_insert(arena, current);
+            return NULL;
+        }
+        rest->address = (char*)current->address + pad;
+        rest->size = current->size - pad;
+        rest->is_purged = current->is_purged;
+        rest->freed_at = current->freed_at;
+        rest->next = current->next;
+        rest->prev = current;
+        if (current->next != NULL) {
+            current->next->prev = rest;
+        }
+        current->next = rest;
+        current->size = pad;
+        bin_insert(arena, current);  // Början blir kvar som ett fritt block
+        current = rest;
+    }
+
+    // Markera blocket som upptaget
+    current->is_free = false;
+
+    // Om blocket är större än vad som behövs, dela upp det i två block vid den avrundade
+    // storleken. Finns ingen deskriptor för resten får anroparen hela blocket.
+    if (current->size > align_up(size)) {
+        split_block(arena, current, align_up(size));
+    }
+    current->is_purged = false;  // Sidorna tas i bruk igen när blocket skrivs
+    arena->free_bytes -= current->size;
+    return current;
+}
+
+// Funktion för att hämta en monoton tidpunkt i millisekunder
+static uint64_t now_ms(void) {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (uint64_t)now.tv_sec * 1000 + (uint64_t)now.tv_nsec / 1000000;
+}
+
+// Funktion för att lämna tillbaka de hela sidorna inuti ett fritt block till operativsystemet.
+// Innehållet i lediga block behövs inte, så sidorna får tas bort och kommer tillbaka
+// nollställda när blocket används igen. Returnerar antalet byte som lämnades tillbaka.
+static size_t block_purge(MemArena* arena, Block* block) {
+    uintptr_t mask = arena->page_size - 1;
+    uintptr_t start = ((uintptr_t)block->address + mask) & ~mask;
+    uintptr_t end = ((uintptr_t)block->address + block->size) & ~mask;
+    block->is_purged = true;
+    if (end <= start) {
+        return 0;
+    }
+#ifdef MADV_FREE
+    // MADV_FREE är billigare men sidorna försvinner först när minnet behövs till annat
+    int advice = arena->options.trim_lazily ? MADV_FREE : MADV_DONTNEED;
+#else
+    int advice = MADV_DONTNEED;
+#endif
+    if (madvise((void*)start, end - start, advice) != 0) {
+        return 0;
+    }
+    return end - start;
+}
+
+// Funktion för att lämna tillbaka alla lediga block på minst 'min_size' byte som har
+// varit lediga sedan 'freed_before'. Anroparen håller arenans lås.
+static size_t arena_purge(MemArena* arena, size_t min_size, uint64_t freed_before) {
+    size_t released = 0;
+    for (size_t bin = find_next_bin(arena, size_to_bin(arena, min_size)); bin < NUM_BINS; bin = find_next_bin(arena, bin + 1)) {
+        FreeBin* free_bin = &arena->free_bins[bin];
+        for (size_t slot = 0; slot < free_bin->count; slot++) {
+            Block* current = free_bin->blocks[slot];
+            if (!current->is_purged && current->size >= min_size && current->freed_at <= freed_before) {
+                released += block_purge(arena, current);
+            }
+        }
+    }
+    return released;
+}
+
+// Funktion som lämnar tillbaka stora lediga block automatiskt när de har varit lediga
+// längre än avklingningstiden. Kontrollen görs när ett stort block frigörs och var
+// TRIM_TICK_INTERVAL:e frigöring, så att block som blir kvar lediga också hinns med.
+// Anroparen håller arenans lås.
+static void arena_trim_tick(MemArena* arena, Block* released) {
+    size_t threshold = arena->options.trim_threshold;
+    bool large = released->size >= threshold;
+    if (!large && ++arena->trim_ticks < TRIM_TICK_INTERVAL) {
+        return;
+    }
+    arena->trim_ticks = 0;
+
+    uint64_t now = now_ms();
+    if (large) {
+        released->freed_at = now;
+    }
+    uint64_t decay = arena->options.trim_decay_ms;
+    if (now - arena->last_trim >= decay && now >= decay) {
+        arena->last_trim = now;
+        arena_purge(arena, threshold, now - decay);
+    }
+}
+
+// Funktion för att hitta området som en adress ligger i, eller NULL om adressen inte hör
+// till poolen. Det första området provas först, och de flesta pooler har bara det.
+static PoolRegion* region_of(MemArena* arena, void* address) {
+    size_t count = __atomic_load_n(&arena->region_count, __ATOMIC_ACQUIRE);
+    for (size_t i = 0; i < count; i++) {
+        PoolRegion* region = &arena->regions[i];
+        if ((char*)address >= region->start && (size_t)((char*)address - region->start) < region->size) {
+            return region;
+        }
+    }
+    return NULL;
+}
+
+// Funktion för att lämna tillbaka ett block med buddy-placering. Kompisen ligger där
+// blockets avstånd från områdets början med blockets storlek bitvis XOR:at pekar, alltså
+// direkt före eller efter blocket. Så länge den är ledig och lika stor slås de ihop och
+// prövas mot nästa storlek. Anroparen håller arenans lås.
+static void buddy_release(MemArena* arena, Block* current) {
+    current->is_free = true;
+    current->is_purged = false;
+    current->freed_at = 0;
+    arena->free_bytes += current->size;
+    arena->buddy_slack -= current->slack;
+
+    char* start = region_of(arena, current->address)->start;
+    for (;;) {
+        size_t offset = (size_t)((char*)current->address - start);
+        bool upper = (offset & current->size) != 0;  // Blocket är den övre halvan av sitt par
+        Block* buddy = upper ? current->prev : current->next;
+        if (buddy == NULL || !buddy->is_free || buddy->size != current->size ||
+            buddy->address != start + (offset ^ current->size)) {
+            break;
+        }
+        bin_remove(arena, buddy);
+        Block* lower = upper ? buddy : current;
+        Block* higher = upper ? current : buddy;
+        lower->size *= 2;
+        lower->is_purged = lower->is_purged && higher->is_purged;
+        lower->next = higher->next;
+        if (higher->next != NULL) {
+            higher->next->prev = lower;
+        }
+        descriptor_free(arena, higher);
+        current = lower;
+    }
+    bin_insert(arena, current);
+
+    if (arena->options.trim_threshold > 0) {
+        arena_trim_tick(arena, current);
+    }
+}
+
+// Funktion för att lämna tillbaka ett upptaget block till poolen och slå ihop det
+// med lediga grannar. Anroparen håller arenans lås.
+static void block_release(MemArena* arena, Block* current) {
+    if (arena->options.placement == MEM_PLACEMENT_BUDDY) {
+        buddy_release(arena, current);
+        return;
+    }
+    // Markera blocket som ledigt. Det har använts, så sidorna är inte längre tömda.
+    current->is_free = true;
+    current->is_purged = false;
+    current->freed_at = 0;
+    arena->free_bytes += current->size;
+
+    // Kontrollera om nästa block också är ledigt och slå ihop dem för att minska fragmentering
+    Block* next = current->next;
+    if (next != NULL && next->is_free) {
+        bin_remove(arena, next);        // Nästa block lämnar sin storleksklass
+        current->size += next->size;    // Lägg till storleken på nästa block
+        current->next = next->next;     // Hoppa över nästa block i listan
+        if (next->next != NULL) {
+            next->next->prev = current;
+        }
+        descriptor_free(arena, next);   // Lämna tillbaka det hopslagna blockets deskriptor
+    }
+
+    // Kontrollera på samma sätt om föregående block är ledigt och låt det ta över blocket
+    Block* prev = current->prev;
+    if (prev != NULL && prev->is_free) {
+        bin_remove(arena, prev);        // Föregående block byter storleksklass
+        prev->size += current->size;    // Föregående block växer med det frigjorda blocket
+        prev->next = current->next;     // Hoppa över det frigjorda blocket i listan
+        if (current->next != NULL) {
+            current->next->prev = prev;
+        }
+        descriptor_free(arena, current);
+        prev->is_purged = false;
+        current = prev;
+    }
+    bin_insert(arena, current);  // Lägg det lediga blocket i rätt storleksklass
+
+    if (arena->options.trim_threshold > 0) {
+        arena_trim_tick(arena, current);
+    }
+}
+
+// Funktion för att räkna upp en av räknarna för mem_get_stats. 'heap' är den anropande
+// trådens egen heap, eller NULL om tråden saknar heap i arenan. Bara tråden skriver i sin
+// heap, så där räcker en vanlig addition som publiceras med en relaxed skrivning.
+static void count_event(MemArena* arena, ThreadHeap* heap, int counter, int64_t delta) {
+    if (heap != NULL) {
+        __atomic_store_n(&heap->counts[counter], heap->counts[counter] + delta, __ATOMIC_RELAXED);
+    } else {
+        __atomic_fetch_add(&arena->counts[counter], delta, __ATOMIC_RELAXED);
+    }
+}
+
+// Funktion för att lägga ett spann först i en av heapens listor
+static void span_push(Span** list, Span* span) {
+    span->prev = NULL;
+    span->next = *list;
+    if (*list != NULL) {
+        (*list)->prev = span;
+    }
+    *list = span;
+}
+
+// Funktion för att ta ut ett spann ur en av heapens listor
+static void span_unlink(Span** list, Span* span) {
+    if (span->prev != NULL) {
+        span->prev->next = span->next;
+    } else {
+        *list = span->next;
+    }
+    if (span->next != NULL) {
+        span->next->prev = span->prev;
+    }
+    span->next = NULL;
+    span->prev = NULL;
+}
+
+// Funktion för att hitta spannet som en adress ligger i, eller NULL för vanliga block
+static Span* span_of(MemArena* arena, void* address) {
+    if (!arena->granules_enabled) {
+        return NULL;
+    }
+    PoolRegion* region = region_of(arena, address);
+    if (region == NULL) {
+        return NULL;
+    }
+    size_t offset = (size_t)((char*)address - region->start);
+    Span* span = &region->span_table[offset >> SPAN_SHIFT];
+    // Skrivs under arenans lås av den tråd som skapar eller släpper spannet
+    return __atomic_load_n(&span->object_size, __ATOMIC_ACQUIRE) != 0 ? span : NULL;
+}
+
+// Funktion för att räkna ut ett objekts nummer i spannet, eller capacity om
+// adressen inte är början på ett objekt
+static size_t span_index(Span* span, void* object) {
+    size_t offset = (size_t)((char*)object - (char*)span->block->address);
+    if (offset % span->object_size != 0) {
+        return span->capacity;
+    }
+    return offset / span->object_size;
+}
+
+// Funktion för att göra ett spann tomt och ge det till en heap. Länken i arenans stack
+// lämnas orörd, eftersom en annan tråd kan läsa den medan den försöker ta spannet.
+static void span_format(Span* span, ThreadHeap* heap, size_t size_class) {
+    __atomic_store_n(&span->owner, heap, __ATOMIC_RELAXED);
+    span->next = NULL;
+    span->prev = NULL;
+    span->free_list = NULL;
+    span->capacity = SPAN_SIZE / ((size_class + 1) * SMALL_OBJECT_STEP);
+    span->carved = 0;
+    span->used = 0;
+    span->is_full = false;
+    memset(span->allocated, 0, sizeof(span->allocated));
+}
+
+// Funktion för att skapa ett nytt spann för en storleksklass. Utan heap blir spannet ett
+// kornspann, med korn i den minsta klassens storlek. Anroparen håller arenans lås.
+static Span* span_create(MemArena* arena, ThreadHeap* heap, size_t size_class) {
+    Block* block = block_alloc(arena, SPAN_SIZE, SPAN_SIZE);
+    if (block == NULL) {
+        return NULL;
+    }
+
+    PoolRegion* region = region_of(arena, block->address);
+    size_t offset = (size_t)((char*)block->address - region->start);
+    Span* span = &region->span_table[offset >> SPAN_SHIFT];
+    span->block = block;
+    span_format(span, heap, size_class);
+    span->is_granular = heap == NULL;
+    memset(span->run_end, 0, sizeof(span->run_end));
+    __atomic_store_n(&span->object_size, (size_class + 1) * SMALL_OBJECT_STEP, __ATOMIC_RELEASE);
+    arena->span_bytes += block->size;
+    return span;
+}
+
+// Funktion för att lämna tillbaka ett tomt spann till poolen. Anroparen håller arenans lås.
+static void span_release(MemArena* arena, Span* span) {
+    __atomic_store_n(&span->object_size, 0, __ATOMIC_RELEASE);
+    arena->span_bytes -= span->block->size;
+    block_release(arena, span->block);
+    span->block = NULL;
+    __atomic_store_n(&span->owner, NULL, __ATOMIC_RELAXED);
+}
+
+// Toppen på en stack av tomma spann är en pekare och en generationsräknare i samma ord.
+// Räknaren ökar vid varje ändring, så en tråd som läste toppen innan ett spann togs och
+// lades tillbaka misslyckas med sitt byte i stället för att lägga en inaktuell länk
+// överst (ABA-problemet). Spannbeskrivningarna frigörs inte medan arenan lever, så
+// länken i ett spann som en annan tråd just har tagit går alltid att läsa.
+#if UINTPTR_MAX > 0xFFFFFFFFu
+#define STACK_POINTER_BITS 48  // Användaradresser ryms i 48 bitar
+#else
+#define STACK_POINTER_BITS 32
+#endif
+#define STACK_POINTER_MASK (((uint64_t)1 << STACK_POINTER_BITS) - 1)
+
+// Funktion för att läsa spannet överst i en stack
+static Span* stack_pointer(uint64_t top) {
+    return (Span*)(uintptr_t)(top & STACK_POINTER_MASK);
+}
+
+// Funktion för att bilda en ny topp med 'span' överst och nästa generation
+static uint64_t stack_next_top(uint64_t top, Span* span) {
+    return (((top >> STACK_POINTER_BITS) + 1) << STACK_POINTER_BITS) | (uint64_t)(uintptr_t)span;
+}
+
+// Funktion för att lägga ett tomt spann på arenans stack för dess storleksklass, utan lås.
+// Spannet behåller sitt block och sin objektstorlek tills det tas igen eller släpps.
+static void span_stack_push(MemArena* arena, Span* span) {
+    uint64_t* stack = &arena->span_stacks[span->object_size / SMALL_OBJECT_STEP - 1];
+    __atomic_store_n(&span->owner, NULL, __ATOMIC_RELAXED);
+    uint64_t top = __atomic_load_n(stack, __ATOMIC_RELAXED);
+    do {
+        __atomic_store_n(&span->stack_next, stack_pointer(top), __ATOMIC_RELAXED);
+    } while (!__atomic_compare_exchange_n(stack, &top, stack_next_top(top, span), true, __ATOMIC_RELEASE, __ATOMIC_RELAXED));
+}
+
+// Funktion för att ta ett tomt spann ur arenans stack för en storleksklass, utan lås.
+// Returnerar NULL om stacken är tom.
+static Span* span_stack_pop(MemArena* arena, size_t size_class) {
+    uint64_t* stack = &arena->span_stacks[size_class];
+    uint64_t top = __atomic_load_n(stack, __ATOMIC_ACQUIRE);
+    while (stack_pointer(top) != NULL) {
+        Span* next = __atomic_load_n(&stack_pointer(top)->stack_next, __ATOMIC_RELAXED);
+        if (__atomic_compare_exchange_n(stack, &top, stack_next_top(top, next), true, __ATOMIC_ACQUIRE, __ATOMIC_ACQUIRE)) {
+            return stack_pointer(top);
+        }
+    }
+    return NULL;
+}
+
+// Funktion för att ta ett tomt spann till en storleksklass utan lås. Klassens egen stack
+// provas först. Annars görs ett spann från en annan klass om, så att minne som nyss
+// användes återanvänds i stället för att nytt minne delas av ur poolen.
+static Span* span_stack_take(MemArena* arena, size_t size_class) {
+    Span* span = span_stack_pop(arena, size_class);
+    for (size_t other = 0; span == NULL && other < SMALL_CLASS_COUNT; other++) {
+        if (other != size_class && stack_pointer(__atomic_load_n(&arena->span_stacks[other], __ATOMIC_RELAXED)) != NULL) {
+            span = span_stack_pop(arena, other);
+        }
+    }
+    if (span != NULL && span->object_size != (size_class + 1) * SMALL_OBJECT_STEP) {
+        __atomic_store_n(&span->object_size, (size_class + 1) * SMALL_OBJECT_STEP, __ATOMIC_RELEASE);
+    }
+    return span;
+}
+
+// Funktion för att lämna tillbaka spannen på arenans alla stackar till poolen, när poolen
+// behöver minnet eller ska trimmas. Anroparen håller arenans lås.
+static void arena_release_span_stacks(MemArena* arena) {
+    for (size_t size_class = 0; size_class < SMALL_CLASS_COUNT; size_class++) {
+        uint64_t* stack = &arena->span_stacks[size_class];
+        uint64_t top = __atomic_load_n(stack, __ATOMIC_ACQUIRE);
+        while (stack_pointer(top) != NULL &&
+               !__atomic_compare_exchange_n(stack, &top, stack_next_top(top, NULL), true, __ATOMIC_ACQUIRE, __ATOMIC_ACQUIRE)) {
+        }
+        Span* span = stack_pointer(top);
+        while (span != NULL) {
+            Span* next = __atomic_load_n(&span->stack_next, __ATOMIC_RELAXED);
+            span_release(arena, span);
+            span = next;
+        }
+    }
+}
+
+// Funktion för att lägga tillbaka ett objekt i sitt spann. Returnerar false om
+// objektet inte är utdelat, till exempel vid dubbel frigöring.
+static bool span_put_object(Span* span, void* object) {
+    size_t index = span_index(span, object);
+    uint64_t bit = 1ULL << (index % 64);
+    if (index >= span->carved || (span->allocated[index / 64] & bit) == 0) {
+        return false;
+    }
+    span->allocated[index / 64] &= ~bit;
+    *(void**)object = span->free_list;  // Länken lagras i det lediga objektet
+    span->free_list = object;
+    span->used--;
+    return true;
+}
+
+// Funktion för att flytta tillbaka ett spann som fått ett ledigt objekt till listan
+// över spann med lediga objekt, och ta ut det om det blivit tomt och heapen har
+// fler spann i klassen. Returnerar true om spannet ska läggas på arenans stack.
+static bool span_after_put(ThreadHeap* heap, Span* span) {
+    size_t size_class = span->object_size / SMALL_OBJECT_STEP - 1;
+    if (span->is_full) {
+        span_unlink(&heap->full[size_class], span);
+        span_push(&heap->available[size_class], span);
+        span->is_full = false;
+    }
+    if (span->used == 0 && (span->next != NULL || span->prev != NULL)) {
+        span_unlink(&heap->available[size_class], span);
+        return true;
+    }
+    return false;
+}
+
+// Funktion för att läsa vilken heap som äger ett spann. Andra trådar läser ägaren utan
+// lås, medan en avslutad tråd kan nollställa den under arenans lås.
+static ThreadHeap* span_owner(Span* span) {
+    return __atomic_load_n(&span->owner, __ATOMIC_ACQUIRE);
+}
+
+// Funktion för att lägga ett objekt som en annan tråd har frigjort i ägarens kö, utan lås.
+// Ägaren tar hela kön på en gång, så ett objekt som läggs till kan aldrig ha tagits ur
+// kön under tiden och ABA-problemet uppstår inte. Returnerar false om ägaren har avslutats.
+static bool remote_push(ThreadHeap* owner, void* object) {
+    void* head = __atomic_load_n(&owner->remote_frees, __ATOMIC_RELAXED);
+    do {
+        if (head == REMOTE_CLOSED) {
+            return false;
+        }
+        *(void**)object = head;  // Länken lagras i det frigjorda objektet
+    } while (!__atomic_compare_exchange_n(&owner->remote_frees, &head, object, true, __ATOMIC_RELEASE, __ATOMIC_RELAXED));
+    return true;
+}
+
+// Funktion för att frigöra ett objekt i ett spann som en annan tråd äger, eller som har
+// blivit ägarlöst. Anroparen håller arenans lås, och då är en ägares kö alltid öppen.
+static void remote_free_locked(MemArena* arena, Span* span, void* object) {
+    ThreadHeap* owner = span_owner(span);
+    if (owner != NULL && remote_push(owner, object)) {
+        return;
+    }
+    // Ägaren har avslutats, så spannet sköts under låset
+    if (!span_put_object(span, object)) {
+        printf("Block not found.\n");
+        return;
+    }
+    count_event(arena, NULL, COUNT_SMALL_BYTES, -(int64_t)span->object_size);
+    if (span->used == 0) {
+        span_stack_push(arena, span);
+    }
+}
+
+// Funktion för att frigöra ett objekt i ett spann som en annan tråd äger. Objektet läggs
+// i ägarens kö utan lås; bara ägarlösa spann kräver arenans lås.
+static void remote_free(MemArena* arena, Span* span, void* object) {
+    ThreadHeap* owner = span_owner(span);
+    if (owner != NULL && remote_push(owner, object)) {
+        return;
+    }
+    pthread_mutex_lock(&arena->lock);
+    remote_free_locked(arena, span, object);
+    pthread_mutex_unlock(&arena->lock);
+}
+
+// Funktion för att lägga tillbaka objekt som andra trådar har frigjort, i en lista tagen
+// ur heapens kö. Anroparen är heapens egen tråd. Ett objekt kan ha hamnat i kön medan
+// en tidigare tråd använde samma heap; det frigörs då som hos en annan ägare.
+// 'locked' anger om anroparen håller arenans lås.
+static void heap_put_remote(ThreadHeap* heap, void* object, bool locked) {
+    MemArena* arena = heap->arena;
+    while (object != NULL) {
+        void* next = *(void**)object;
+        Span* span = span_of(arena, object);
+        if (span != NULL && span_owner(span) == heap) {
+            if (span_put_object(span, object)) {
+                count_event(arena, heap, COUNT_SMALL_BYTES, -(int64_t)span->object_size);
+                if (span_after_put(heap, span)) {
+                    span_stack_push(arena, span);
+                }
+            }
+        } else if (span != NULL && locked) {
+            remote_free_locked(arena, span, object);
+        } else if (span != NULL) {
+            remote_free(arena, span, object);
+        }
+        object = next;
+    }
+}
+
+// Funktion för att ta hand om objekt som andra trådar har frigjort i heapens spann.
+// Hela kön tas på en gång av heapens egen tråd, så inget lås behövs.
+static void heap_drain_remote(ThreadHeap* heap) {
+    if (__atomic_load_n(&heap->remote_frees, __ATOMIC_RELAXED) == NULL) {
+        return;
+    }
+    heap_put_remote(heap, __atomic_exchange_n(&heap->remote_frees, NULL, __ATOMIC_ACQUIRE), false);
+}
+
+// Funktion för att släppa heapens tomma spann tillbaka till poolen. Anroparen håller arenans lås.
+static void heap_trim(ThreadHeap* heap) {
+    for (size_t size_class = 0; size_class < SMALL_CLASS_COUNT; size_class++) {
+        Span* span = heap->available[size_class];
+        while (span != NULL) {
+            Span* next = span->next;
+            if (span->used == 0) {
+                span_unlink(&heap->available[size_class], span);
+                span_release(heap->arena, span);
+            }
+            span = next;
+        }
+    }
+}
+
+// Funktion för att lämna ifrån sig en heap. Kön stängs, tomma spann går tillbaka till
+// poolen och spann med utdelade objekt blir ägarlösa tills deras sista objekt frigörs.
+// Anroparen håller arenans lås.
+static void heap_orphan(ThreadHeap* heap) {
+    heap_put_remote(heap, __atomic_exchange_n(&heap->remote_frees, REMOTE_CLOSED, __ATOMIC_ACQUIRE), true);
+    heap_trim(heap);
+    for (size_t size_class = 0; size_class < SMALL_CLASS_COUNT; size_class++) {
+        Span* lists[2] = {heap->available[size_class], heap->full[size_class]};
+        for (int i = 0; i < 2; i++) {
+            Span* span = lists[i];
+            while (span != NULL) {
+                Span* next = span->next;
+                __atomic_store_n(&span->owner, NULL, __ATOMIC_RELEASE);
+                span->next = NULL;
+                span->prev = NULL;
+                span->is_full = false;
+                span = next;
+            }
+        }
+    }
+
+    // Trådens räknare lever vidare i arenans
+    MemArena* arena = heap->arena;
+    for (int counter = 0; counter < NUM_COUNTERS; counter++) {
+        __atomic_fetch_add(&arena->counts[counter], heap->counts[counter], __ATOMIC_RELAXED);
+    }
+    if (heap->prev_in_arena != NULL) {
+        heap->prev_in_arena->next_in_arena = heap->next_in_arena;
+    } else {
+        arena->heaps = heap->next_in_arena;
+    }
+    if (heap->next_in_arena != NULL) {
+        heap->next_in_arena->prev_in_arena = heap->prev_in_arena;
+    }
+}
+
+// Funktion som körs när en tråd avslutas. Heaparna i arenor som fortfarande lever
+// lämnas ifrån sig och sparas åt nya trådar, eftersom andra trådar fortfarande kan ha
+// en pekare till heapens kö. Heapar i arenor som redan har rivits frigörs bara.
+static void heap_destroy(void* arg) {
+    (void)arg;  // Trådens heapar nås via thread_heaps, som lever kvar under destruktorn
+    while (thread_heaps != NULL) {
+        ThreadHeap* heap = thread_heaps;
+        thread_heaps = heap->next;
+
+        // Arenan får inte rivas medan heapen lämnas ifrån sig
+        pthread_mutex_lock(&arena_list_lock);
+        for (MemArena* arena = arena_list; arena != NULL; arena = arena->next) {
+            if (arena == heap->arena && arena->id == heap->arena_id) {
+                pthread_mutex_lock(&arena->lock);
+                heap_orphan(heap);
+                heap->next = arena->retired_heaps;
+                arena->retired_heaps = heap;
+                pthread_mutex_unlock(&arena->lock);
+                heap = NULL;
+                break;
+            }
+        }
+        pthread_mutex_unlock(&arena_list_lock);
+        free(heap);
+    }
+}
+
+// Funktion för att skapa nyckeln vars destruktor städar upp en avslutad tråds heapar
+static void heap_key_create(void) {
+    pthread_key_create(&heap_key, heap_destroy);
+}
+
+// Funktion för att hitta den anropande trådens heap i en arena utan att skapa den
+static ThreadHeap* find_thread_heap(MemArena* arena) {
+    for (ThreadHeap* heap = thread_heaps; heap != NULL; heap = heap->next) {
+        if (heap->arena == arena) {
+            return heap->arena_id == arena->id ? heap : NULL;
+        }
+    }
+    return NULL;
+}
+
+// Funktion för att hämta den anropande trådens heap i en arena, och skapa den första
+// gången. Den senast använda heapen flyttas först så att nästa uppslag går direkt.
+static ThreadHeap* get_thread_heap(MemArena* arena) {
+    ThreadHeap* heap = thread_heaps;
+    if (heap != NULL && heap->arena == arena && heap->arena_id == arena->id) {
+        return heap;
+    }
+
+    ThreadHeap** link = &thread_heaps;
+    while (*link != NULL && (*link)->arena != arena) {
+        link = &(*link)->next;
+    }
+    heap = *link;
+    if (heap != NULL) {
+        *link = heap->next;
+    }
+    if (heap == NULL || heap->arena_id != arena->id) {
+        // En heap som en avslutad tråd har lämnat efter sig används i första hand. En heap
+        // från en tidigare arena på samma adress används om, dess spann finns inte längre.
+        pthread_mutex_lock(&arena->lock);
+        if (heap == NULL && arena->retired_heaps != NULL) {
+            heap = arena->retired_heaps;
+            arena->retired_heaps = heap->next;
+        }
+        if (heap == NULL) {
+            heap = (ThreadHeap*)calloc(1, sizeof(ThreadHeap));
+        }
+        if (heap == NULL) {
+            pthread_mutex_unlock(&arena->lock);
+            return NULL;
+        }
+        // Kön öppnas för sig, eftersom en tråd som frigör kan läsa den samtidigt
+        memset(heap, 0, offsetof(ThreadHeap, remote_pad));
+        __atomic_store_n(&heap->remote_frees, NULL, __ATOMIC_RELEASE);
+        heap->arena = arena;
+        heap->arena_id = arena->id;
+
+        // Heapen läggs in i arenans lista så att mem_get_stats når dess räknare
+        heap->next_in_arena = arena->heaps;
+        if (arena->heaps != NULL) {
+            arena->heaps->prev_in_arena = heap;
+        }
+        arena->heaps = heap;
+        pthread_mutex_unlock(&arena->lock);
+        pthread_once(&heap_key_once, heap_key_create);
+        pthread_setspecific(heap_key, heap);  // Värdet måste vara skilt från NULL för att destruktorn ska köras
+    }
+    heap->next = thread_heaps;
+    thread_heaps = heap;
+    return heap;
+}
+
+// Funktion för att frigöra den anropande trådens heap i en arena som rivs
+static void drop_thread_heap(MemArena* arena) {
+    for (ThreadHeap** link = &thread_heaps; *link != NULL; link = &(*link)->next) {
+        if ((*link)->arena == arena) {
+            ThreadHeap* heap = *link;
+            *link = heap->next;
+            free(heap);
+            return;
+        }
+    }
+}
+
+// Funktion för att sätta eller rensa 'count' bitar från bit 'first' i en bitkarta, ett ord i taget
+static void bits_assign(uint64_t* words, size_t first, size_t count, bool set) {
+    while (count > 0) {
+        size_t bit = first % 64;
+        size_t length = 64 - bit < count ? 64 - bit : count;
+        uint64_t mask = (length == 64 ? ~0ULL : (1ULL << length) - 1) << bit;
+        if (set) {
+            words[first / 64] |= mask;
+        } else {
+            words[first / 64] &= ~mask;
+        }
+        first += length;
+        count -= length;
+    }
+}
+
+// Funktion för att hitta den första följden av 'count' lediga korn i ett kornspann.
+// En bit i 'runs' betyder att kornet och de följande är lediga så långt som hittills
+// kontrollerats. Varje skift fördubblar den längden, så en följd av 16 korn kräver
+// fyra skift per ord, och början hittas sedan med en bitskanning.
+// Returnerar kornets nummer, eller SPAN_MAX_OBJECTS om ingen följd räcker.
+static size_t granule_find(Span* span, size_t count) {
+    uint64_t runs[SPAN_BITMAP_WORDS];
+    for (size_t word = 0; word < SPAN_BITMAP_WORDS; word++) {
+        runs[word] = ~span->allocated[word];
+    }
+    size_t length = 1;
+    while (length < count) {
+        size_t shift = length < count - length ? length : count - length;
+        for (size_t word = 0; word < SPAN_BITMAP_WORDS; word++) {
+            // Bitarna från nästa ord skiftas in ovanifrån, så följder kan gå över ordgränser
+            uint64_t next = word + 1 < SPAN_BITMAP_WORDS ? runs[word + 1] : 0;
+            runs[word] &= (runs[word] >> shift) | (next << (64 - shift));
+        }
+        length += shift;
+    }
+    for (size_t word = 0; word < SPAN_BITMAP_WORDS; word++) {
+        if (runs[word] != 0) {
+            return word * 64 + (size_t)__builtin_ctzll(runs[word]);
+        }
+    }
+    return SPAN_MAX_OBJECTS;
+}
+
+// Funktion för att räkna ut hur många korn objektet på 'object' består av. Returnerar 0
+// om adressen inte är början på ett utdelat objekt, till exempel vid dubbel frigöring.
+static size_t granule_run(Span* span, void* object) {
+    size_t index = span_index(span, object);
+    if (index >= SPAN_MAX_OBJECTS || (span->allocated[index / 64] & (1ULL << (index % 64))) == 0) {
+        return 0;
+    }
+    // Kornet före måste vara ledigt eller sist i ett annat objekt
+    if (index > 0) {
+        size_t before = index - 1;
+        uint64_t bit = 1ULL << (before % 64);
+        if ((span->allocated[before / 64] & bit) != 0 && (span->run_end[before / 64] & bit) == 0) {
+            return 0;
+        }
+    }
+    // Objektet slutar vid första slutbiten från kornet och framåt
+    size_t word = index / 64;
+    uint64_t ends = span->run_end[word] & (~0ULL << (index % 64));
+    while (ends == 0) {
+        ends = span->run_end[++word];
+    }
+    return word * 64 + (size_t)__builtin_ctzll(ends) - index + 1;
+}
+
+// Funktion för att dela ut ett objekt på 'size' byte ur arenans kornspann. Ett nytt
+// kornspann skapas när inget av de befintliga har en tillräckligt lång följd av lediga
+// korn. Returnerar NULL om inte heller det går. Anroparen håller arenans lås.
+static void* granule_alloc(MemArena* arena, size_t size) {
+    size_t count = (size + SMALL_OBJECT_STEP - 1) / SMALL_OBJECT_STEP;
+    size_t index = SPAN_MAX_OBJECTS;
+    Span* span = arena->granule_spans;
+    while (span != NULL) {
+        if (span->used + count <= SPAN_MAX_OBJECTS) {
+            index = granule_find(span, count);
+            if (index < SPAN_MAX_OBJECTS) {
+                break;
+            }
+        }
+        span = span->next;
+    }
+    if (span == NULL) {
+        span = span_create(arena, NULL, 0);
+        if (span == NULL) {
+            return NULL;
+        }
+        index = 0;
+    } else {
+        span_unlink(&arena->granule_spans, span);
+    }
+    span_push(&arena->granule_spans, span);  // Nästa sökning börjar i samma spann
+
+    bits_assign(span->allocated, index, count, true);
+    span->run_end[(index + count - 1) / 64] |= 1ULL << ((index + count - 1) % 64);
+    span->used += count;
+    count_event(arena, NULL, COUNT_SMALL_BYTES, (int64_t)(count * SMALL_OBJECT_STEP));
+    return (char*)span->block->address + index * SMALL_OBJECT_STEP;
+}
+
+// Funktion för att frigöra ett objekt i ett kornspann. Ett kornspann som blir tomt
+// lämnas tillbaka till poolen, utom när det är arenans enda. Anroparen håller arenans lås.
+static void granule_free(MemArena* arena, Span* span, void* object) {
+    size_t count = granule_run(span, object);
+    if (count == 0) {
+        printf("Block not found.\n");
+        return;
+    }
+    size_t index = span_index(span, object);
+    bits_assign(span->allocated, index, count, false);
+    span->run_end[(index + count - 1) / 64] &= ~(1ULL << ((index + count - 1) % 64));
+    span->used -= count;
+    count_event(arena, NULL, COUNT_SMALL_BYTES, -(int64_t)(count * SMALL_OBJECT_STEP));
+    if (span->used == 0 && (span->next != NULL || span->prev != NULL)) {
+        span_unlink(&arena->granule_spans, span);
+        span_release(arena, span);
+    }
+}
+
+// Funktion för att lämna tillbaka arenans tomma kornspann till poolen. Anroparen håller arenans lås.
+static void granule_trim(MemArena* arena) {
+    Span* span = arena->granule_spans;
+    while (span != NULL) {
+        Span* next = span->next;
+        if (span->used == 0) {
+            span_unlink(&arena->granule_spans, span);
+            span_release(arena, span);
+        }
+        span = next;
+    }
+}
+
+// Funktion för att dela ut ett objekt ur trådens spann. När trådens spann i klassen är
+// slut fylls cachen på med ett helt spann åt gången, i första hand ett tomt spann från
+// arenans stack. Låset tas bara när stacken också är tom.
+static void* small_alloc(ThreadHeap* heap, size_t size_class) {
+    Span* span = heap->available[size_class];
+    if (span == NULL) {
+        heap_drain_remote(heap);  // Objekt som andra trådar har frigjort kommer först
+        span = heap->available[size_class];
+    }
+    if (span == NULL) {
+        span = span_stack_take(heap->arena, size_class);
+        if (span != NULL) {
+            span_format(span, heap, size_class);
+            span_push(&heap->available[size_class], span);
+        }
+    }
+    if (span == NULL) {
+        MemArena* arena = heap->arena;
+        pthread_mutex_lock(&arena->lock);
+        span = span_create(arena, heap, size_class);
+        if (span == NULL) {
+            // Tomma spann i andra klasser kan ha tagit det sista av poolen
+            arena_release_span_stacks(arena);
+            span = span_create(arena, heap, size_class);
+        }
+        if (span != NULL) {
+            span_push(&heap->available[size_class], span);
+        }
+        pthread_mutex_unlock(&arena->lock);
+        if (span == NULL) {
+            return NULL;
+        }
+    }
+
+    // Återanvänd ett frigjort objekt, annars tas nästa objekt från spannets början
+    void* object;
+    if (span->free_list != NULL) {
+        object = span->free_list;
+        span->free_list = *(void**)object;
+    } else {
+        object = (char*)span->block->address + (size_t)span->carved * span->object_size;
+        span->carved++;
+    }
+    size_t index = span_index(span, object);
+    span->allocated[index / 64] |= 1ULL << (index % 64);
+    span->used++;
+    count_event(heap->arena, heap, COUNT_SMALL_BYTES, span->object_size);
+
+    // Ett fullt spann flyttas undan så att nästa allokering hittar ett med lediga objekt
+    if (span->free_list == NULL && span->carved == span->capacity) {
+        span_unlink(&heap->available[size_class], span);
+        span_push(&heap->full[size_class], span);
+        span->is_full = true;
+    }
+    return object;
+}
+
+// Funktion för att frigöra ett objekt i ett spann. 'heap' är den anropande trådens heap
+// i arenan, eller NULL.
+static void small_free(MemArena* arena, ThreadHeap* heap, Span* span, void* object) {
+    // Kornspann har ingen ägare, de sköts alltid under låset
+    if (span->is_granular) {
+        pthread_mutex_lock(&arena->lock);
+        granule_free(arena, span, object);
+        pthread_mutex_unlock(&arena->lock);
+        return;
+    }
+
+    // Ägaren lägger tillbaka objektet, och ett tomt spann går till arenans stack, utan lås
+    if (heap != NULL && span_owner(span) == heap) {
+        if (!span_put_object(span, object)) {
+            printf("Block not found.\n");
+            return;
+        }
+        count_event(arena, heap, COUNT_SMALL_BYTES, -(int64_t)span->object_size);
+        if (span_after_put(heap, span)) {
+            span_stack_push(arena, span);
+        }
+        return;
+    }
+
+    if (span_index(span, object) >= span->capacity) {
+        printf("Block not found.\n");
+        return;
+    }
+    // Lämna objektet till ägaren, som tar hand om det nästa gång dess spann tar slut
+    remote_free(arena, span, object);
+}
+
+// Funktion för att reservera ett anonymt minnesområde på 'length' byte som börjar på en
+// multipel av 'align'. Området tas lite större och det som blir över i ändarna lämnas tillbaka.
+static void* map_aligned(PoolRegion* region, size_t length, size_t align, int flags) {
+    size_t mapping_size = length + align;
+    char* mapping = (char*)mmap(NULL, mapping_size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | flags, -1, 0);
+    if (mapping == MAP_FAILED) {
+        return NULL;
+    }
+    char* start = (char*)(((uintptr_t)mapping + align - 1) & ~(uintptr_t)(align - 1));
+    if (start > mapping) {
+        munmap(mapping, (size_t)(start - mapping));
+    }
+    size_t tail = (size_t)(mapping + mapping_size - (start + length));
+    if (tail > 0) {
+        munmap(start + length, tail);
+    }
+    region->mapping = start;
+    region->mapping_size = length;
+    return start;
+}
+
+// Funktion för att skaffa minne till ett område på det sätt som alternativen anger.
+// Går stora sidor inte att få faller den tillbaka på vanliga sidor. Returnerar hur
+// minnet faktiskt skaffades, och sätter region->start till NULL om det misslyckades.
+static MemBacking region_map(MemArena* arena, PoolRegion* region, size_t size) {
+    size_t length = size > 0 ? size : 1;
+    region->mapping = NULL;
+    region->mapping_size = 0;
+
+    if (arena->options.backing == MEM_BACKING_MALLOC) {
+        // Området börjar på en spanngräns, så att spannen kan justeras mot adresserna
+        // och alla block får standardjusteringen
+        void* start;
+        region->start = posix_memalign(&start, SPAN_SIZE, length) == 0 ? (char*)start : NULL;
+        return MEM_BACKING_MALLOC;
+    }
+
+    // mmap ger sidjusterat minne, och sidorna tas i bruk först när de rörs
+    length = (length + SPAN_SIZE - 1) & ~(SPAN_SIZE - 1);
+    if (arena->options.backing == MEM_BACKING_HUGE_PAGES) {
+        size_t huge_length = (length + HUGE_PAGE_SIZE - 1) & ~(HUGE_PAGE_SIZE - 1);
+#ifdef MAP_HUGETLB
+        // Explicita stora sidor finns bara om de har reserverats i förväg (vm.nr_hugepages)
+        void* start = mmap(NULL, huge_length, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+        if (start != MAP_FAILED) {
+            region->start = (char*)start;
+            region->mapping = start;
+            region->mapping_size = huge_length;
+            arena->page_size = HUGE_PAGE_SIZE;  // Explicita stora sidor kan bara lämnas tillbaka hela
+            return MEM_BACKING_HUGE_PAGES;
+        }
+#endif
+#ifdef MADV_HUGEPAGE
+        // Annars be om transparenta stora sidor för ett område som börjar på en stor sida
+        region->start = (char*)map_aligned(region, huge_length, HUGE_PAGE_SIZE, 0);
+        if (region->start != NULL && madvise(region->start, huge_length, MADV_HUGEPAGE) == 0) {
+            return MEM_BACKING_HUGE_PAGES;
+        }
+        if (region->start != NULL) {
+            return MEM_BACKING_MMAP;  // Kärnan sa nej, men området går att använda
+        }
+#endif
+    }
+    region->start = (char*)map_aligned(region, length, SPAN_SIZE, 0);
+    return MEM_BACKING_MMAP;
+}
+
+// Funktion för att lämna tillbaka ett områdes minne på samma sätt som det skaffades
+static void region_unmap(PoolRegion* region) {
+    if (region->mapping != NULL) {
+        munmap(region->mapping, region->mapping_size);
+    } else {
+        free(region->start);
+    }
+    free(region->span_table);
+    memset(region, 0, sizeof(PoolRegion));
+}
+
+// Funktion för att lägga till ett område på 'size' byte i poolen, som ett enda fritt block.
+// Används när arenan skapas och när poolen växer; i det senare fallet håller anroparen arenans lås.
+static bool arena_add_region(MemArena* arena, size_t size) {
+    size_t count = arena->region_count;
+    if (count == MAX_POOL_REGIONS) {
+        return false;
+    }
+    PoolRegion* region = &arena->regions[count];
+    MemBacking backing = region_map(arena, region, size);
+    if (region->start == NULL) {
+        return false;
+    }
+    if (count == 0) {
+        arena->backing = backing;
+    }
+    region->size = size;
+
+    // Ett område som kan innehålla spann behöver en spannbeskrivning per spannplats.
+    // Tabellen täcker även en ofullständig sista spannplats, som aldrig blir ett spann.
+    if (arena->granules_enabled) {
+        region->span_table = (Span*)calloc((size + SPAN_SIZE - 1) >> SPAN_SHIFT, sizeof(Span));
+        if (region->span_table == NULL && count == 0) {
+            arena->caches_enabled = false;  // Poolen fungerar, men utan trådcachar och kornspann
+            arena->granules_enabled = false;
+        } else if (region->span_table == NULL) {
+            region_unmap(region);
+            return false;
+        }
+    }
+
+    // Skapa ett första block som representerar hela området
+    region->head = descriptor_alloc(arena);
+    if (region->head == NULL) {
+        // Felhantering om blockallokeringen misslyckas
+        printf("Failed to allocate head block.\n");
+        region_unmap(region);
+        return false;
+    }
+
+    // Initialisera första blocket
+    Block* head = region->head;
+    head->address = region->start;  // Blockets adress pekar på början av området
+    head->size = size;              // Blockets storlek är lika med hela områdets storlek
+    head->is_free = true;           // Blocket markeras som ledigt
+    head->is_purged = false;        // Områdets sidor kan redan vara i bruk
+    head->freed_at = 0;
+    head->next = NULL;              // Inget nästa block, eftersom detta är det enda blocket just nu
+    head->prev = NULL;              // Inget föregående block heller
+    arena->free_bytes += size;      // Hela området är ledigt
+    arena->pool_size += size;
+    region_insert(arena, head);     // Lägg in hela området som ett fritt block
+
+    // Området räknas in först när det är klart, så att span_of kan läsa det utan lås
+    __atomic_store_n(&arena->region_count, count + 1, __ATOMIC_RELEASE);
+    return true;
+}
+
+// Funktion för att låta poolen växa med ett nytt område där minst 'needed' byte får plats.
+// Poolen dubblas åt gången, men aldrig över taket i alternativen. Anroparen håller arenans lås.
+static bool arena_grow(MemArena* arena, size_t needed) {
+    size_t limit = arena->options.max_size;
+    if (limit <= arena->pool_size) {
+        return false;  // Poolen får inte växa, eller har redan nått taket
+    }
+    size_t room = limit - arena->pool_size;
+    size_t size = needed > arena->pool_size ? needed : arena->pool_size;
+    if (size > room) {
+        size = room;
+    }
+    return size >= needed && arena_add_region(arena, size);
+}
+
+// Funktion för att anteckna ett nytt block så att mem_release kan frigöra det.
+// Görs bara medan någon kontrollpunkt är öppen. Anroparen håller arenans lås.
+static void mark_log_add(MemArena* arena, void* address) {
+    if (arena->mark_count == 0) {
+        return;
+    }
+    if (arena->mark_log_count == arena->mark_log_capacity) {
+        size_t capacity = arena->mark_log_capacity > 0 ? arena->mark_log_capacity * 2 : MIN_TABLE_CAPACITY;
+        void** log = (void**)realloc(arena->mark_log, capacity * sizeof(void*));
+        if (log == NULL) {
+            printf("Failed to record block for mem_release.\n");
+            return;
+        }
+        arena->mark_log = log;
+        arena->mark_log_capacity = capacity;
+    }
+    arena->mark_log[arena->mark_log_count++] = address;
+}
+
+// Funktion för att komma ihåg en adress från en allokering på noll byte, så att mem_free
+// på den inte frigör blocket som senare hamnar på samma adress. Anroparen håller arenans lås.
+static bool zero_add(MemArena* arena, void* address) {
+    if (arena->zero_count == arena->zero_capacity) {
+        size_t capacity = arena->zero_capacity > 0 ? arena->zero_capacity * 2 : MIN_TABLE_CAPACITY;
+        void** zero_blocks = (void**)realloc(arena->zero_blocks, capacity * sizeof(void*));
+        if (zero_blocks == NULL) {
+            return false;
+        }
+        arena->zero_blocks = zero_blocks;
+        arena->zero_capacity = capacity;
+    }
+    arena->zero_blocks[arena->zero_count] = address;
+    __atomic_store_n(&arena->zero_count, arena->zero_count + 1, __ATOMIC_RELAXED);
+    return true;
+}
+
+// Funktion för att glömma en adress från en allokering på noll byte. Returnerar false om
+// adressen inte kom från en sådan allokering. Anroparen håller arenans lås.
+static bool zero_take(MemArena* arena, void* address) {
+    for (size_t i = arena->zero_count; i > 0; i--) {
+        if (arena->zero_blocks[i - 1] == address) {
+            arena->zero_blocks[i - 1] = arena->zero_blocks[arena->zero_count - 1];
+            __atomic_store_n(&arena->zero_count, arena->zero_count - 1, __ATOMIC_RELAXED);
+            return true;
+        }
+    }
+    return false;
+}
+
+// Funktion för att allokera ett vanligt block ur poolen på en adress som är en multipel
+// av 'align'. Anroparen håller arenans lås.
+static void* pool_alloc(MemArena* arena, size_t size, size_t align) {
+    // En arena som inte är initierad, eller redan är avslutad, har inga block att dela ut
+    if (arena->region_count == 0) {
+        printf("No suitable block found.\n");
+        return NULL;
+    }
+
+    // En allokering på noll byte reserverar inget, utan pekar bara ut var nästa block hamnar.
+    // Adressen sparas, så att mem_free på den inte frigör nästa block.
+    if (size == 0) {
+        Block* current = find_free_block(arena, 0);
+        if (current == NULL || !zero_add(arena, current->address)) {
+            printf("No suitable block found.\n");
+            return NULL;
+        }
+        return current->address;
+    }
+
+    // Se till att det finns plats för blocket i adresstabellen
+    if (!table_reserve(arena, 1)) {
+        printf("Failed to grow block table.\n");
+        return NULL;
+    }
+
+    // Hämta ett tillräckligt stort ledigt block ur storleksklasserna. Alla block är redan
+    // justerade till MEM_ALIGNMENT, så bara större justeringar behöver en utfyllnad först.
+    // Utfyllnaden blir ett eget fritt block som slås ihop med blocket igen när det frigörs.
+    if (align <= MEM_ALIGNMENT) {
+        align = 1;
+    }
+    Block* current = block_alloc(arena, size, align);
+    if (current == NULL && arena->granules_enabled) {
+        // Tomma spann i trådens cache, på arenans stackar och bland kornspannen kan ha
+        // delat upp minnet, så släpp dem och försök igen
+        ThreadHeap* heap = arena->caches_enabled ? find_thread_heap(arena) : NULL;
+        if (heap != NULL) {
+            heap_trim(heap);
+        }
+        arena_release_span_stacks(arena);
+        granule_trim(arena);
+        current = block_alloc(arena, size, align);
+    }
+    size_t needed = arena->options.placement == MEM_PLACEMENT_BUDDY ? buddy_size(size, align) : size + align - 1;
+    if (current == NULL && arena_grow(arena, needed)) {
+        // Poolen fick ett nytt område där blocket säkert får plats
+        current = block_alloc(arena, size, align);
+    }
+    if (current == NULL) {
+        // Om inget passande block hittas, skriv ut ett felmeddelande och returnera NULL
+        printf("No suitable block found.\n");
+        return NULL;
+    }
+
+    // Registrera blocket så att mem_free och mem_resize hittar det direkt
+    table_put(arena, current);
+    mark_log_add(arena, current->address);
+
+    // Returnera adressen till det allokerade blocket
+    return current->address;
+}
+
+// Funktion för att initiera en arena med en pool på 'size' byte. NULL som alternativ
+// ger standardvärdena.
+static bool arena_setup(MemArena* arena, size_t size, const MemOptions* options) {
+    if (options != NULL) {
+        arena->options = *options;
+    } else {
+        memset(&arena->options, 0, sizeof(arena->options));
+    }
+
+    // Trådcachar från en tidigare arena på samma adress blir ogiltiga
+    arena->id = __atomic_add_fetch(&next_arena_id, 1, __ATOMIC_RELAXED);
+
+    // Dimensionera deskriptorerna och tabellen för ett block per 64 byte, dock högst
+    // MAX_BLOCKS block. Båda växer av sig själva om fler block behövs.
+    size_t expected_blocks = size / 64 < MAX_BLOCKS ? size / 64 : MAX_BLOCKS;
+    arena->descriptor_chunks = NULL;
+    arena->free_descriptors = NULL;
+    arena->next_chunk_count = expected_blocks > MIN_DESCRIPTOR_CHUNK ? expected_blocks : MIN_DESCRIPTOR_CHUNK;
+
+    // Töm storleksklasserna och stackarna av tomma spann
+    memset(arena->free_bins, 0, sizeof(arena->free_bins));
+    memset(arena->bin_bitmap, 0, sizeof(arena->bin_bitmap));
+    arena->bin_summary = 0;
+    memset(arena->span_stacks, 0, sizeof(arena->span_stacks));
+    arena->size_tree = NULL;
+    arena->rover = NULL;
+    arena->rover_region = 0;
+    arena->free_bytes = 0;
+    arena->pool_size = 0;
+    arena->region_count = 0;
+    arena->page_size = (size_t)sysconf(_SC_PAGESIZE);
+    arena->last_trim = 0;
+    arena->trim_ticks = 0;
+    arena->heaps = NULL;
+    arena->retired_heaps = NULL;
+    memset(arena->counts, 0, sizeof(arena->counts));
+    arena->free_blocks = 0;
+    arena->span_bytes = 0;
+    arena->buddy_slack = 0;
+    arena->searches = 0;
+    arena->search_steps = 0;
+    arena->max_search = 0;
+
+    // Små pooler delar inte upp minnet i spann, där räcker den vanliga vägen. Trådcacharna
+    // kräver större pooler än kornspannen, så de har alltid spannbeskrivningar.
+    bool spans = !arena->options.no_small_spans;
+    arena->caches_enabled = spans && size >= MIN_CACHED_POOL;
+    arena->granules_enabled = spans && size >= MIN_GRANULE_POOL;
+
+    // Processorns förmågor läses en gång här i stället för vid varje sökning
+#if defined(__x86_64__)
+    __builtin_cpu_init();
+    arena->scan_avx2 = __builtin_cpu_supports("avx2");
+#else
+    arena->scan_avx2 = false;
+#endif
+    arena->granule_spans = NULL;
+
+    // Allokera minnespoolen med angiven storlek
+    if (!arena_add_region(arena, size)) {
+        // Felhantering om allokeringen misslyckas
+        printf("Failed to allocate memory pool.\n");
+        DescriptorChunk* chunk = arena->descriptor_chunks;
+        while (chunk != NULL) {
+            DescriptorChunk* temp = chunk;
+            chunk = chunk->next;
+            free(temp);
+        }
+        arena->descriptor_chunks = NULL;
+        arena->free_descriptors = NULL;
+        arena->caches_enabled = false;
+        arena->granules_enabled = false;
+        return false;
+    }
+
+    // Skapa adresstabellen med plats för de förväntade blocken
+    size_t capacity = MIN_TABLE_CAPACITY;
+    while (capacity < expected_blocks * 2) {
+        capacity *= 2;
+    }
+    if (!table_create(arena, capacity)) {
+        printf("Failed to allocate block table.\n");
+    }
+
+    // Registrera arenan så att mem_arena_of och trådarnas destruktorer hittar den
+    pthread_mutex_lock(&arena_list_lock);
+    arena->next = arena_list;
+    arena_list = arena;
+    pthread_mutex_unlock(&arena_list_lock);
+    return true;
+}
+
+// Funktion för att frigöra alla handtag i en arena vars block försvinner på en gång
+static void handles_free(MemArena* arena) {
+    while (arena->handles != NULL) {
+        MemHandle* handle = arena->handles;
+        arena->handles = handle->next;
+        free(handle);
+    }
+    arena->compact_cursor = NULL;
+    arena->compact_region = 0;
+}
+
+// Funktion för att riva en arena. Allt minne lämnas tillbaka på en gång, utan att
+// blocken gås igenom ett och ett.
+static void arena_teardown(MemArena* arena) {
+    // Avregistrera arenan så att avslutade trådar inte längre rör den
+    pthread_mutex_lock(&arena_list_lock);
+    for (MemArena** link = &arena_list; *link != NULL; link = &(*link)->next) {
+        if (*link == arena) {
+            *link = arena->next;
+            break;
+        }
+    }
+    pthread_mutex_unlock(&arena_list_lock);
+
+    // Den anropande trådens heap frigörs direkt, andra trådars glöms via arenans id.
+    // Heapar som avslutade trådar har lämnat efter sig behövs inte längre.
+    drop_thread_heap(arena);
+    arena->heaps = NULL;
+    while (arena->retired_heaps != NULL) {
+        ThreadHeap* heap = arena->retired_heaps;
+        arena->retired_heaps = heap->next;
+        free(heap);
+    }
+
+    // Frigör poolens områden och deras spannbeskrivningar
+    for (size_t i = 0; i < arena->region_count; i++) {
+        region_unmap(&arena->regions[i]);
+    }
+    arena->region_count = 0;
+    arena->pool_size = 0;
+
+    // Frigör alla förråd av deskriptorer på en gång, utan att gå igenom blocken
+    DescriptorChunk* chunk = arena->descriptor_chunks;
+    while (chunk != NULL) {
+        DescriptorChunk* temp = chunk;  // Temporär pekare för att hålla förrådet som ska frigöras
+        chunk = chunk->next;            // Gå till nästa förråd
+        free(temp);                     // Frigör nuvarande förråd
+    }
+    arena->descriptor_chunks = NULL;
+    arena->free_descriptors = NULL;
+
+    // Töm storleksklasserna och frigör deras vektorer
+    bins_clear(arena, true);
+    arena->size_tree = NULL;
+    arena->rover = NULL;
+
+    arena->free_bytes = 0;
+
+    // Frigör adresstabellen
+    free(arena->block_table);
+    arena->block_table = NULL;
+    arena->table_capacity = 0;
+    arena->table_count = 0;
+
+    // Frigör kontrollpunkterna
+    free(arena->marks);
+    free(arena->mark_log);
+    arena->marks = NULL;
+    arena->mark_log = NULL;
+    arena->mark_count = 0;
+    arena->mark_capacity = 0;
+    arena->mark_log_count = 0;
+    arena->mark_log_capacity = 0;
+
+    // Frigör adresserna från allokeringar på noll byte
+    free(arena->zero_blocks);
+    arena->zero_blocks = NULL;
+    arena->zero_count = 0;
+    arena->zero_capacity = 0;
+
+    // Handtagens block finns inte längre
+    handles_free(arena);
+
+    arena->caches_enabled = false;
+    arena->granules_enabled = false;
+    arena->granule_spans = NULL;
+}
+
+// Funktion för att välja arena, där NULL betyder standardarenan
+static MemArena* arena_or_default(MemArena* arena) {
+    return arena != NULL ? arena : &default_arena;
+}
+
+// Funktion för att skapa en ny arena med en egen pool på 'size' byte
+MemArena* mem_arena_create(size_t size) {
+    return mem_arena_create_with_options(size, NULL);
+}
+
+// Funktion för att skapa en ny arena med givna alternativ, till exempel hur poolen får sitt minne
+MemArena* mem_arena_create_with_options(size_t size, const MemOptions* options) {
+    MemArena* arena = (MemArena*)calloc(1, sizeof(MemArena));
+    if (arena == NULL) {
+        printf("Failed to allocate arena.\n");
+        return NULL;
+    }
+    pthread_mutex_init(&arena->lock, NULL);
+    if (!arena_setup(arena, size, options)) {
+        pthread_mutex_destroy(&arena->lock);
+        free(arena);
+        return NULL;
+    }
+    return arena;
+}
+
+// Funktion för att riva en arena och allt minne som delats ut ur den
+void mem_arena_destroy(MemArena* arena) {
+    if (arena == NULL || arena == &default_arena) {
+        return;  // Standardarenan rivs med mem_deinit
+    }
+    arena_teardown(arena);
+    pthread_mutex_destroy(&arena->lock);
+    free(arena);
+}
+
+// Funktion för att ta reda på hur arenans pool faktiskt fick sitt minne
+MemBacking mem_arena_backing(MemArena* arena) {
+    return arena_or_default(arena)->backing;
+}
+
+// Funktion för att knyta en egen pekare till arenan, till exempel strukturen som äger den.
+// Pekaren lämnas orörd av mem_arena_reset och försvinner med arenan.
+void mem_arena_set_user_data(MemArena* arena, void* data) {
+    arena_or_default(arena)->user_data = data;
+}
+
+// Funktion för att hämta pekaren som knutits till arenan, NULL om ingen har satts
+void* mem_arena_user_data(MemArena* arena) {
+    return arena_or_default(arena)->user_data;
+}
+
+// Funktion för att hitta arenan vars pool innehåller 'block'
+MemArena* mem_arena_of(void* block) {
+    MemArena* found = NULL;
+    pthread_mutex_lock(&arena_list_lock);
+    for (MemArena* arena = arena_list; arena != NULL; arena = arena->next) {
+        if (region_of(arena, block) != NULL) {
+            found = arena;
+            break;
+        }
+    }
+    pthread_mutex_unlock(&arena_list_lock);
+    return found;
+}
+
+#ifdef MEM_TRACE
+// Spårning av anropen till mem_alloc, mem_free och mem_resize, se mem_trace.h.
+// Varje levande block får ett id, så att spåret kan spelas upp där adresserna blir andra.
+
+// En post i tabellen som översätter blockens adresser till deras id
+typedef struct TraceEntry {
+    void* address;  // Blockets adress, NULL om platsen är ledig
+    uint32_t id;    // Blockets id i spåret
+} TraceEntry;
+
+static pthread_mutex_t trace_lock = PTHREAD_MUTEX_INITIALIZER;  // Skyddar allt nedan
+static FILE* trace_file;            // Spårfilen, öppnas vid första anropet
+static bool trace_disabled;         // Filen gick inte att öppna, så inget spåras
+static uint64_t trace_start;        // Tidpunkt (ns) för första anropet
+static uint32_t trace_next_id = 1;  // Id för nästa block, 0 betyder inget block
+static TraceEntry* trace_table;     // Levande block, öppen adressering med adressen som nyckel
+static size_t trace_capacity;       // Antal platser i tabellen (alltid en tvåpotens)
+static size_t trace_count;          // Antal block i tabellen
+
+// Funktion för att hämta en monoton tidpunkt i nanosekunder
+static uint64_t trace_now(void) {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (uint64_t)now.tv_sec * 1000000000 + (uint64_t)now.tv_nsec;
+}
+
+// Funktion för att skriva ut det som ligger kvar i bufferten när programmet avslutas
+static void trace_close(void) {
+    pthread_mutex_lock(&trace_lock);
+    if (trace_file != NULL) {
+        fclose(trace_file);
+        trace_file = NULL;
+    }
+    trace_disabled = true;
+    pthread_mutex_unlock(&trace_lock);
+}
+
+// Funktion för att öppna spårfilen första gången något ska spåras. Anroparen håller trace_lock.
+static bool trace_open(void) {
+    if (trace_file != NULL) {
+        return true;
+    }
+    if (trace_disabled) {
+        return false;
+    }
+    const char* path = getenv("MEM_TRACE_FILE");
+    trace_file = fopen(path != NULL ? path : "mem_trace.bin", "wb");
+    if (trace_file == NULL) {
+        printf("Failed to open trace file.\n");
+        trace_disabled = true;
+        return false;
+    }
+    MemTraceHeader header = {MEM_TRACE_MAGIC, MEM_TRACE_VERSION};
+    fwrite(&header, sizeof(header), 1, trace_file);
+    trace_start = trace_now();
+    atexit(trace_close);
+    return true;
+}
+
+// Funktion för att lägga till en post i spårfilen. Anroparen håller trace_lock.
+static void trace_write(MemTraceOp op, size_t size, uint32_t id) {
+    if (!trace_open()) {
+        return;
+    }
+    MemTraceRecord record;
+    memset(&record, 0, sizeof(record));
+    record.timestamp = trace_now() - trace_start;
+    record.size = size;
+    record.id = id;
+    record.op = (uint8_t)op;
+    fwrite(&record, sizeof(record), 1, trace_file);
+}
+
+// Funktion för att räkna ut första platsen i tabellen för en adress
+static size_t trace_slot(void* address) {
+    return (size_t)(((uint64_t)(uintptr_t)address * 0x9E3779B97F4A7C15ULL) >> 32) & (trace_capacity - 1);
+}
+
+// Funktion för att lägga in ett block med ett givet id. Tabellen dubblas när den blir
+// halvfull. Returnerar 0 om tabellen inte kunde växa, annars id. Anroparen håller trace_lock.
+static uint32_t trace_put(void* address, uint32_t id) {
+    if ((trace_count + 1) * 2 > trace_capacity) {
+        TraceEntry* old_table = trace_table;
+        size_t old_capacity = trace_capacity;
+        size_t capacity = old_capacity > 0 ? old_capacity * 2 : MIN_TABLE_CAPACITY;
+        TraceEntry* table = (TraceEntry*)calloc(capacity, sizeof(TraceEntry));
+        if (table == NULL) {
+            return 0;
+        }
+        trace_table = table;
+        trace_capacity = capacity;
+        for (size_t i = 0; i < old_capacity; i++) {
+            if (old_table[i].address != NULL) {
+                size_t slot = trace_slot(old_table[i].address);
+                while (trace_table[slot].address != NULL) {
+                    slot = (slot + 1) & (capacity - 1);
+                }
+                trace_table[slot] = old_table[i];
+            }
+        }
+        free(old_table);
+    }
+
+    size_t slot = trace_slot(address);
+    while (trace_table[slot].address != NULL) {
+        slot = (slot + 1) & (trace_capacity - 1);  // Linjär sondering
+    }
+    trace_table[slot].address = address;
+    trace_table[slot].id = id;
+    trace_count++;
+    return id;
+}
+
+// Funktion för att ta bort ett block ur tabellen och returnera dess id, eller 0 om
+// adressen inte är ett levande block. Anroparen håller trace_lock.
+static uint32_t trace_take(void* address) {
+    if (trace_capacity == 0 || address == NULL) {
+        return 0;
+    }
+    size_t mask = trace_capacity - 1;
+    size_t slot = trace_slot(address);
+    while (trace_table[slot].address != address) {
+        if (trace_table[slot].address == NULL) {
+            return 0;
+        }
+        slot = (slot + 1) & mask;
+    }
+    uint32_t id = trace_table[slot].id;
+
+    // Flytta bakåt de efterföljande posterna som annars inte längre skulle hittas
+    size_t hole = slot;
+    for (size_t next = (hole + 1) & mask; trace_table[next].address != NULL; next = (next + 1) & mask) {
+        size_t home = trace_slot(trace_table[next].address);
+        if (((next - home) & mask) >= ((next - hole) & mask)) {
+            trace_table[hole] = trace_table[next];
+            hole = next;
+        }
+    }
+    trace_table[hole].address = NULL;
+    trace_count--;
+    return id;
+}
+
+// Funktion för att spåra en allokering som redan har gjorts
+static void trace_alloc(size_t size, void* result) {
+    pthread_mutex_lock(&trace_lock);
+    // En allokering på noll byte reserverar inget och får därför inget id
+    uint32_t id = result != NULL && size > 0 ? trace_put(result, trace_next_id++) : 0;
+    trace_write(MEM_TRACE_ALLOC, size, id);
+    pthread_mutex_unlock(&trace_lock);
+}
+
+// Funktion för att spåra en satsallokering som redan har gjorts, med en post per block
+static void trace_alloc_batch(size_t count, size_t size, void** out) {
+    pthread_mutex_lock(&trace_lock);
+    for (size_t i = 0; i < count; i++) {
+        uint32_t id = out[i] != NULL && size > 0 ? trace_put(out[i], trace_next_id++) : 0;
+        trace_write(MEM_TRACE_ALLOC, size, id);
+    }
+    pthread_mutex_unlock(&trace_lock);
+}
+
+// Funktion för att spåra en frigöring. Den spåras innan blocket frigörs, så att en
+// annan tråd som får samma adress inte hinner registrera den först.
+static void trace_free(void* block) {
+    pthread_mutex_lock(&trace_lock);
+    trace_write(MEM_TRACE_FREE, 0, trace_take(block));
+    pthread_mutex_unlock(&trace_lock);
+}
+
+// Funktion för att spåra en satsfrigöring, med en post per block som i mem_free
+static void trace_free_batch(void** blocks, size_t count) {
+    pthread_mutex_lock(&trace_lock);
+    for (size_t i = 0; i < count; i++) {
+        trace_write(MEM_TRACE_FREE, 0, trace_take(blocks[i]));
+    }
+    pthread_mutex_unlock(&trace_lock);
+}
+
+// Funktion för att frigöra allt sedan en kontrollpunkt och spåra varje block som
+// försvinner. Hela anropet görs under trace_lock, precis som trace_resize, så att
+// adresserna inte hinner delas ut igen innan tabellen är uppdaterad.
+static void trace_release(MemMark mark) {
+    pthread_mutex_lock(&trace_lock);
+    pthread_mutex_lock(&default_arena.lock);
+    if (mark != MEM_MARK_INVALID && mark <= default_arena.mark_count) {
+        for (size_t i = default_arena.mark_log_count; i > default_arena.marks[mark - 1]; i--) {
+            uint32_t id = trace_take(default_arena.mark_log[i - 1]);
+            if (id != 0) {
+                trace_write(MEM_TRACE_FREE, 0, id);  // Block som redan frigjorts har inget id
+            }
+        }
+    }
+    pthread_mutex_unlock(&default_arena.lock);
+    mem_arena_release(&default_arena, mark);
+    pthread_mutex_unlock(&trace_lock);
+}
+
+// Funktion för att ändra storlek och spåra det. Hela anropet görs under trace_lock,
+// eftersom det gamla blocket frigörs mitt i och dess adress annars kan delas ut igen
+// innan tabellen är uppdaterad.
+static void* trace_resize(void* block, size_t size) {
+    pthread_mutex_lock(&trace_lock);
+    uint32_t id = trace_take(block);
+    void* result = mem_arena_resize(&default_arena, block, size);
+    if (id != 0) {
+        // Blocket behåller sitt id även om det flyttades, och det gamla finns kvar om det misslyckades
+        trace_put(result != NULL ? result : block, id);
+    }
+    trace_write(MEM_TRACE_RESIZE, size, id);
+    pthread_mutex_unlock(&trace_lock);
+    return result;
+}
+
+// Funktion för att spåra att alla levande block försvann med mem_deinit eller mem_init
+static void trace_reset(void) {
+    pthread_mutex_lock(&trace_lock);
+    if (trace_count > 0) {
+        memset(trace_table, 0, trace_capacity * sizeof(TraceEntry));
+        trace_count = 0;
+        trace_write(MEM_TRACE_RESET, 0, 0);
+    }
+    pthread_mutex_unlock(&trace_lock);
+}
+#endif
+
+// Funktion för att initiera minnespoolen
+void mem_init(size_t size) {
+    mem_init_with_options(size, NULL);
+}
+
+// Funktion för att initiera minnespoolen med givna alternativ
+void mem_init_with_options(size_t size, const MemOptions* options) {
+    // En tidigare pool rivs i stället för att läcka
+    if (default_arena.region_count > 0) {
+        mem_deinit();
+    }
+    if (arena_setup(&default_arena, size, options)) {
+        memory_pool = default_arena.regions[0].start;
+        head_pool = default_arena.regions[0].head;
+    }
+}
+
+// Funktion för att avgöra om någon kontrollpunkt från mem_mark är öppen
+static bool marks_open(MemArena* arena) {
+    return __atomic_load_n(&arena->mark_count, __ATOMIC_RELAXED) > 0;
+}
+
+// Funktion för att allokera minne ur en arena utan att räkna anropet. Sätter '*heap'
+// till den anropande trådens heap om den behövdes.
+static void* arena_alloc(MemArena* arena, size_t size, ThreadHeap** heap) {
+    *heap = NULL;
+    if (size > MAX_REQUEST_SIZE) {
+        printf("No suitable block found.\n");
+        return NULL;
+    }
+    if (size == 0) {
+        // Noll byte får en adress men inget block, se pool_alloc
+        pthread_mutex_lock(&arena->lock);
+        void* result = pool_alloc(arena, 0, MEM_ALIGNMENT);
+        pthread_mutex_unlock(&arena->lock);
+        return result;
+    }
+
+    // Små allokeringar tas ur trådens egna spann utan lås. Medan en kontrollpunkt är
+    // öppen går allt via poolen, så att mem_release vet vad som har allokerats.
+    if (size <= SMALL_OBJECT_LIMIT && arena->caches_enabled && !marks_open(arena)) {
+        *heap = get_thread_heap(arena);
+        if (*heap != NULL) {
+            void* object = small_alloc(*heap, (size - 1) / SMALL_OBJECT_STEP);
+            if (object != NULL) {
+                return object;
+            }
+        }
+    }
+
+    // Övriga allokeringar går till den delade poolen. Små tas där ur kornspannen, så att
+    // de slipper en egen deskriptor, och blir vanliga block först när inget kornspann får plats.
+    pthread_mutex_lock(&arena->lock);
+    void* result = NULL;
+    if (size <= SMALL_OBJECT_LIMIT && arena->granules_enabled && !marks_open(arena)) {
+        result = granule_alloc(arena, size);
+    }
+    if (result == NULL) {
+        result = pool_alloc(arena, size, MEM_ALIGNMENT);
+    }
+    pthread_mutex_unlock(&arena->lock);
+    return result;
+}
+
+// Funktion för att allokera minne ur en arena
+void* mem_arena_alloc(MemArena* arena, size_t size) {
+    arena = arena_or_default(arena);
+    ThreadHeap* heap;
+    void* result = arena_alloc(arena, size, &heap);
+    count_event(arena, heap, COUNT_ALLOCS, 1);
+    if (result == NULL) {
+        count_event(arena, heap, COUNT_FAILED, 1);
+    }
+    return result;
+}
+
+// Funktion för att allokera minne från poolen
+void* mem_alloc(size_t size) {
+#ifdef MEM_TRACE
+    void* result = mem_arena_alloc(&default_arena, size);
+    trace_alloc(size, result);
+    return result;
+#else
+    return mem_arena_alloc(&default_arena, size);
+#endif
+}
+
+// Funktion för att allokera minne ur en arena på en adress som är en multipel av
+// 'align', till exempel en cacheline eller en sida
+void* mem_arena_alloc_aligned(MemArena* arena, size_t size, size_t align) {
+    // Justeringen måste vara en tvåpotens
+    if (align == 0 || (align & (align - 1)) != 0) {
+        printf("Invalid alignment.\n");
+        count_event(arena_or_default(arena), NULL, COUNT_ALLOCS, 1);
+        count_event(arena_or_default(arena), NULL, COUNT_FAILED, 1);
+        return NULL;
+    }
+    if (align <= MEM_ALIGNMENT) {
+        return mem_arena_alloc(arena, size);  // Alla block har redan standardjusteringen
+    }
+
+    arena = arena_or_default(arena);
+    void* result = NULL;
+    if (size > MAX_REQUEST_SIZE) {
+        printf("No suitable block found.\n");
+    } else {
+        pthread_mutex_lock(&arena->lock);
+        result = pool_alloc(arena, size, align);
+        pthread_mutex_unlock(&arena->lock);
+    }
+    count_event(arena, NULL, COUNT_ALLOCS, 1);
+    if (result == NULL) {
+        count_event(arena, NULL, COUNT_FAILED, 1);
+    }
+    return result;
+}
+
+// Funktion för att allokera minne från poolen med en given justering
+void* mem_alloc_aligned(size_t size, size_t align) {
+#ifdef MEM_TRACE
+    void* result = mem_arena_alloc_aligned(&default_arena, size, align);
+    trace_alloc(size, result);
+    return result;
+#else
+    return mem_arena_alloc_aligned(&default_arena, size, align);
+#endif
+}
+
+// Funktion för att ta reda på hur stort det levande blocket på 'block' är, 0 om inget finns
+static size_t live_size(MemArena* arena, void* block) {
+    Span* span = span_of(arena, block);
+    size_t size = 0;
+    pthread_mutex_lock(&arena->lock);
+    if (span != NULL) {
+        size = span->is_granular ? granule_run(span, block) * SMALL_OBJECT_STEP : span->object_size;
+    } else {
+        Block* current = table_get(arena, block);
+        size = current != NULL ? current->size : 0;
+    }
+    pthread_mutex_unlock(&arena->lock);
+    return size;
+}
+
+// Funktion för att glömma 'block' om det kom från en allokering på noll byte. En sådan
+// adress kan också vara ett levande blocks, och då är det adressen från nollallokeringen
+// som släpps; blocket frigörs först när dess adress lämnas tillbaka en gång till.
+static bool zero_free(MemArena* arena, void* block) {
+    if (__atomic_load_n(&arena->zero_count, __ATOMIC_RELAXED) == 0) {
+        return false;
+    }
+    pthread_mutex_lock(&arena->lock);
+    bool taken = zero_take(arena, block);
+    pthread_mutex_unlock(&arena->lock);
+    return taken;
+}
+
+// Funktion för att frigöra ett block i en arena när anropet redan är räknat
+static void arena_free(MemArena* arena, ThreadHeap* heap, void* block) {
+    // NULL frigör ingenting, och en adress från en allokering på noll byte har inget eget block
+    if (block == NULL || zero_free(arena, block)) {
+        return;
+    }
+
+    // Objekt i ett spann går tillbaka till spannet
+    Span* span = span_of(arena, block);
+    if (span != NULL) {
+        small_free(arena, heap, span, block);
+        return;
+    }
+
+    pthread_mutex_lock(&arena->lock);
+
+    // Slå upp blocket i adresstabellen, där bara upptagna block finns
+    Block* current = table_take(arena, block);
+    if (current == NULL) {
+        // Om blocket inte hittas (eller redan är frigjort), skriv ut ett felmeddelande
+        pthread_mutex_unlock(&arena->lock);
+        printf("Block not found.\n");
+        return;
+    }
+    block_release(arena, current);
+
+    pthread_mutex_unlock(&arena->lock);
+}
+
+// Funktion för att frigöra ett block i en arena
+void mem_arena_free(MemArena* arena, void* block) {
+    arena = arena_or_default(arena);
+    ThreadHeap* heap = arena->caches_enabled ? find_thread_heap(arena) : NULL;
+    count_event(arena, heap, COUNT_FREES, 1);
+    arena_free(arena, heap, block);
+}
+
+// Funktion för att dela ett nyss allokerat block i 'count' block om 'stride' byte var,
+// som registreras ett och ett. Det sista blocket får det som blir över. Returnerar hur
+// många block det blev; går det inte att få deskriptorer lämnas resten tillbaka.
+// Anroparen håller arenans lås och har reserverat plats i adresstabellen.
+static size_t carve_blocks(MemArena* arena, Block* block, size_t count, size_t stride, void** out) {
+    size_t carved = 1;
+    Block* current = block;
+    while (carved < count) {
+        Block* piece = descriptor_alloc(arena);
+        if (piece == NULL) {
+            break;
+        }
+        piece->address = (char*)current->address + stride;
+        piece->size = current->size - stride;
+        piece->is_free = false;
+        piece->is_purged = false;
+        piece->freed_at = 0;
+        piece->next = current->next;
+        piece->prev = current;
+        if (current->next != NULL) {
+            current->next->prev = piece;
+        }
+        current->next = piece;
+        current->size = stride;
+        table_put(arena, current);
+        mark_log_add(arena, current->address);
+        out[carved - 1] = current->address;
+        current = piece;
+        carved++;
+    }
+    if (carved < count) {
+        // Resten räcker till flera block men deskriptorerna tog slut
+        block_release(arena, current);
+        return carved - 1;
+    }
+    table_put(arena, current);
+    mark_log_add(arena, current->address);
+    out[carved - 1] = current->address;
+    return carved;
+}
+
+// Funktion för att allokera 'count' block på 'size' byte var ur en arena och lägga
+// adresserna i 'out'. Vanliga block tas om möjligt ur ett enda ledigt block som delas
+// upp, och hela satsen görs under ett låstagande. Returnerar antalet block som
+// allokerades; platserna i 'out' för block som inte fick plats sätts till NULL.
+size_t mem_arena_alloc_batch(MemArena* arena, size_t count, size_t size, void** out) {
+    arena = arena_or_default(arena);
+    size_t done = 0;
+    ThreadHeap* heap = NULL;
+
+    if (size > MAX_REQUEST_SIZE) {
+        printf("No suitable block found.\n");
+    } else if (size > 0 && size <= SMALL_OBJECT_LIMIT && arena->caches_enabled && !marks_open(arena)) {
+        // Små block tas ur trådens egna spann utan lås, precis som i mem_alloc
+        heap = get_thread_heap(arena);
+        while (heap != NULL && done < count && (out[done] = small_alloc(heap, (size - 1) / SMALL_OBJECT_STEP)) != NULL) {
+            done++;
+        }
+    }
+
+    if (done < count && size <= MAX_REQUEST_SIZE) {
+        pthread_mutex_lock(&arena->lock);
+        size_t stride = align_up(size);
+        size_t remaining = count - done;
+        bool carve = arena->options.placement != MEM_PLACEMENT_BUDDY;  // Kompisar kan inte delas godtyckligt
+        if (carve && size > 0 && remaining > 1 && stride <= MAX_REQUEST_SIZE / remaining && table_reserve(arena, remaining)) {
+            Block* block = block_alloc(arena, remaining * stride, 1);
+            if (block != NULL) {
+                done += carve_blocks(arena, block, remaining, stride, out + done);
+            }
+        }
+        // Blocken får inte plats i ett stycke, så de tas ett och ett
+        while (done < count) {
+            out[done] = pool_alloc(arena, size, MEM_ALIGNMENT);
+            if (out[done] == NULL) {
+                break;
+            }
+            done++;
+        }
+        pthread_mutex_unlock(&arena->lock);
+    }
+
+    for (size_t i = done; i < count; i++) {
+        out[i] = NULL;
+    }
+    count_event(arena, heap, COUNT_ALLOCS, (int64_t)count);
+    if (done < count) {
+        count_event(arena, heap, COUNT_FAILED, (int64_t)(count - done));
+    }
+    return done;
+}
+
+// Funktion för att allokera flera block på en gång ur poolen
+size_t mem_alloc_batch(size_t count, size_t size, void** out) {
+#ifdef MEM_TRACE
+    size_t done = mem_arena_alloc_batch(&default_arena, count, size, out);
+    trace_alloc_batch(count, size, out);
+    return done;
+#else
+    return mem_arena_alloc_batch(&default_arena, count, size, out);
+#endif
+}
+
+// Funktion för att avgöra om ett fritt block ligger i sin storleksklass. Block som
+// frigörs i en sats läggs in först när de har slagits ihop med sina grannar.
+static bool in_bin(Block* block) {
+    return block->free_slot != NOT_IN_BIN;
+}
+
+// Funktion för att markera ett block som ledigt utan att lägga det i sin storleksklass.
+// Anroparen håller arenans lås och slår sedan ihop blocken med coalesce_freed.
+static void mark_freed(MemArena* arena, Block* block) {
+    block->is_free = true;
+    block->freed_at = 0;
+    arena->free_bytes += block->size;
+}
+
+// Funktion för att slå ihop varje följd av lediga block som innehåller något av de
+// 'count' blocken i 'freed' till ett block, och lägga det i sin storleksklass.
+// Hopslagna deskriptorer får adressen NULL; inga nya deskriptorer tas ut här, så de
+// hinner inte återanvändas innan de har hoppats över. Anroparen håller arenans lås.
+static void coalesce_freed(MemArena* arena, Block** freed, size_t count) {
+    if (arena->options.placement == MEM_PLACEMENT_BUDDY) {
+        // Kompisar slås ihop parvis, så blocken lämnas tillbaka ett och ett
+        for (size_t i = 0; i < count; i++) {
+            freed[i]->is_free = false;
+            arena->free_bytes -= freed[i]->size;
+        }
+        for (size_t i = 0; i < count; i++) {
+            buddy_release(arena, freed[i]);
+        }
+        return;
+    }
+    for (size_t i = 0; i < count; i++) {
+        Block* current = freed[i];
+        if (current->address == NULL) {
+            continue;  // Redan hopslaget med ett tidigare block
+        }
+        while (current->prev != NULL && current->prev->is_free) {
+            current = current->prev;  // Gå till början av följden
+        }
+        if (in_bin(current)) {
+            bin_remove(arena, current);
+        }
+        while (current->next != NULL && current->next->is_free) {
+            Block* next = current->next;
+            if (in_bin(next)) {
+                bin_remove(arena, next);
+            }
+            current->size += next->size;
+            current->next = next->next;
+            if (next->next != NULL) {
+                next->next->prev = current;
+            }
+            next->address = NULL;
+            descriptor_free(arena, next);
+        }
+        current->is_purged = false;  // Följden innehåller sidor som just har använts
+        bin_insert(arena, current);
+        if (arena->options.trim_threshold > 0) {
+            arena_trim_tick(arena, current);
+        }
+    }
+}
+
+// Funktion för att frigöra 'count' block i en arena på en gång. Blocken tas
+// FREE_BATCH_CHUNK åt gången: alla markeras först som lediga, och sedan slås varje
+// sammanhängande följd av lediga block ihop en gång, i stället för en gång per block.
+// NULL i listan hoppas över.
+void mem_arena_free_batch(MemArena* arena, void** blocks, size_t count) {
+    arena = arena_or_default(arena);
+    ThreadHeap* heap = arena->caches_enabled ? find_thread_heap(arena) : NULL;
+    count_event(arena, heap, COUNT_FREES, (int64_t)count);
+
+    // Adresser från allokeringar på noll byte måste kännas igen en och en
+    if (__atomic_load_n(&arena->zero_count, __ATOMIC_RELAXED) > 0) {
+        for (size_t i = 0; i < count; i++) {
+            arena_free(arena, heap, blocks[i]);
+        }
+        return;
+    }
+
+    for (size_t first = 0; first < count; first += FREE_BATCH_CHUNK) {
+        size_t end = count - first > FREE_BATCH_CHUNK ? first + FREE_BATCH_CHUNK : count;
+
+        // Objekt i spann går tillbaka till sina spann, utan lås när tråden äger dem
+        bool pool_blocks = false;
+        for (size_t i = first; i < end; i++) {
+            Span* span = blocks[i] != NULL ? span_of(arena, blocks[i]) : NULL;
+            if (span != NULL) {
+                small_free(arena, heap, span, blocks[i]);
+            } else if (blocks[i] != NULL) {
+                pool_blocks = true;
+            }
+        }
+        if (!pool_blocks) {
+            continue;
+        }
+
+        pthread_mutex_lock(&arena->lock);
+
+        // Markera blocken som lediga utan att lägga dem i storleksklasserna
+        Block* freed[FREE_BATCH_CHUNK];
+        size_t taken = 0;
+        for (size_t i = first; i < end; i++) {
+            if (blocks[i] == NULL || span_of(arena, blocks[i]) != NULL) {
+                continue;
+            }
+            Block* current = table_take(arena, blocks[i]);
+            if (current == NULL) {
+                printf("Block not found.\n");
+                continue;
+            }
+            mark_freed(arena, current);
+            freed[taken++] = current;
+        }
+
+        coalesce_freed(arena, freed, taken);
+        pthread_mutex_unlock(&arena->lock);
+    }
+}
+
+// Funktion för att frigöra flera block på en gång i poolen
+void mem_free_batch(void** blocks, size_t count) {
+#ifdef MEM_TRACE
+    trace_free_batch(blocks, count);
+#endif
+    mem_arena_free_batch(&default_arena, blocks, count);
+}
+
+// Funktion för att tömma en arena på alla block på en gång. Poolens områden behålls
+// och blir ett fritt block vardera. Kostnaden beror på antalet områden och förråd,
+// inte på hur många block som var allokerade.
+void mem_arena_reset(MemArena* arena) {
+    arena = arena_or_default(arena);
+    if (arena->region_count == 0) {
+        return;
+    }
+    pthread_mutex_lock(&arena->lock);
+
+    // Trådarnas spann försvinner, så deras heapar glöms via ett nytt id. Räknarna för
+    // anropen sparas, men inga småobjekt finns kvar.
+    for (ThreadHeap* heap = arena->heaps; heap != NULL; heap = heap->next_in_arena) {
+        for (int counter = 0; counter < NUM_COUNTERS; counter++) {
+            arena->counts[counter] += heap->counts[counter];
+        }
+    }
+    arena->counts[COUNT_SMALL_BYTES] = 0;
+    arena->heaps = NULL;
+    memset(arena->span_stacks, 0, sizeof(arena->span_stacks));
+    drop_thread_heap(arena);
+    arena->id = __atomic_add_fetch(&next_arena_id, 1, __ATOMIC_RELAXED);
+
+    // Behåll bara det senaste förrådet av deskriptorer, och dela ut det från början igen
+    DescriptorChunk* chunk = arena->descriptor_chunks;
+    while (chunk->next != NULL) {
+        DescriptorChunk* temp = chunk->next;
+        chunk->next = temp->next;
+        free(temp);
+    }
+    chunk->used = 0;
+    arena->free_descriptors = NULL;
+
+    // En ny, nollställd adresstabell är billigare än att tömma den gamla plats för plats
+    size_t capacity = arena->table_capacity > 0 ? arena->table_capacity : MIN_TABLE_CAPACITY;
+    free(arena->block_table);
+    arena->block_table = NULL;
+    if (!table_create(arena, capacity)) {
+        printf("Failed to allocate block table.\n");
+    }
+
+    // Töm storleksklasserna och alla kontrollpunkter; vektorerna behålls
+    bins_clear(arena, false);
+    arena->size_tree = NULL;
+    arena->rover = NULL;
+    arena->rover_region = 0;
+    arena->free_blocks = 0;
+    arena->free_bytes = 0;
+    arena->span_bytes = 0;
+    arena->granule_spans = NULL;
+    arena->buddy_slack = 0;
+    __atomic_store_n(&arena->mark_count, 0, __ATOMIC_RELAXED);
+    arena->mark_log_count = 0;
+    __atomic_store_n(&arena->zero_count, 0, __ATOMIC_RELAXED);
+    handles_free(arena);
+
+    // Varje område blir ett enda fritt block igen, med nollställda spannbeskrivningar
+    for (size_t i = 0; i < arena->region_count; i++) {
+        PoolRegion* region = &arena->regions[i];
+        if (region->span_table != NULL) {
+            size_t span_bytes = ((region->size + SPAN_SIZE - 1) >> SPAN_SHIFT) * sizeof(Span);
+            Span* table = (Span*)calloc(1, span_bytes);
+            if (table != NULL) {
+                free(region->span_table);
+                region->span_table = table;
+            } else {
+                memset(region->span_table, 0, span_bytes);
+            }
+        }
+        Block* head = descriptor_alloc(arena);  // Förrådet har plats, det var tomt
+        head->address = region->start;
+        head->size = region->size;
+        head->is_free = true;
+        head->is_purged = false;
+        head->freed_at = 0;
+        head->next = NULL;
+        head->prev = NULL;
+        region->head = head;
+        arena->free_bytes += region->size;
+        region_insert(arena, head);
+    }
+    if (arena == &default_arena) {
+        head_pool = arena->regions[0].head;
+    }
+    pthread_mutex_unlock(&arena->lock);
+}
+
+// Funktion för att tömma standardpoolen på alla block på en gång
+void mem_reset(void) {
+#ifdef MEM_TRACE
+    trace_reset();
+#endif
+    mem_arena_reset(&default_arena);
+}
+
+// Funktion för att öppna en kontrollpunkt. Allt som allokeras i arenan efter den,
+// av alla trådar, kan frigöras på en gång med mem_arena_release.
+MemMark mem_arena_mark(MemArena* arena) {
+    arena = arena_or_default(arena);
+    pthread_mutex_lock(&arena->lock);
+    if (arena->mark_count == arena->mark_capacity) {
+        size_t capacity = arena->mark_capacity > 0 ? arena->mark_capacity * 2 : 8;
+        size_t* marks = (size_t*)realloc(arena->marks, capacity * sizeof(size_t));
+        if (marks == NULL) {
+            pthread_mutex_unlock(&arena->lock);
+            printf("Failed to create mark.\n");
+            return MEM_MARK_INVALID;
+        }
+        arena->marks = marks;
+        arena->mark_capacity = capacity;
+    }
+    arena->marks[arena->mark_count] = arena->mark_log_count;
+    __atomic_store_n(&arena->mark_count, arena->mark_count + 1, __ATOMIC_RELAXED);
+    MemMark mark = arena->mark_count;
+    pthread_mutex_unlock(&arena->lock);
+    return mark;
+}
+
+// Funktion för att öppna en kontrollpunkt i standardpoolen
+MemMark mem_mark(void) {
+    return mem_arena_mark(&default_arena);
+}
+
+// Funktion för att frigöra allt som har allokerats sedan kontrollpunkten 'mark' och
+// stänga den, tillsammans med alla kontrollpunkter som öppnats efter den. Block som
+// redan har frigjorts hoppas över. Blocken slås ihop en gång per följd, som i mem_free_batch.
+void mem_arena_release(MemArena* arena, MemMark mark) {
+    arena = arena_or_default(arena);
+    pthread_mutex_lock(&arena->lock);
+    if (mark == MEM_MARK_INVALID || mark > arena->mark_count) {
+        pthread_mutex_unlock(&arena->lock);
+        printf("Invalid mark.\n");
+        return;
+    }
+
+    size_t first = arena->marks[mark - 1];
+    while (arena->mark_log_count > first) {
+        Block* freed[FREE_BATCH_CHUNK];
+        size_t taken = 0;
+        while (taken < FREE_BATCH_CHUNK && arena->mark_log_count > first) {
+            Block* current = table_take(arena, arena->mark_log[--arena->mark_log_count]);
+            if (current != NULL) {
+                mark_freed(arena, current);
+                freed[taken++] = current;
+            }
+        }
+        coalesce_freed(arena, freed, taken);
+    }
+    __atomic_store_n(&arena->mark_count, mark - 1, __ATOMIC_RELAXED);
+    pthread_mutex_unlock(&arena->lock);
+}
+
+// Funktion för att frigöra allt som har allokerats i standardpoolen sedan 'mark'
+void mem_release(MemMark mark) {
+#ifdef MEM_TRACE
+    trace_release(mark);
+#else
+    mem_arena_release(&default_arena, mark);
+#endif
+}
+
+// Funktion för att allokera ett flyttbart block i en arena. Blocket tas ur poolen som
+// vanligt men tas sedan bort ur adresstabellen, så att bara handtaget når det.
+MemHandle* mem_arena_handle_alloc(MemArena* arena, size_t size) {
+    arena = arena_or_default(arena);
+    count_event(arena, NULL, COUNT_ALLOCS, 1);  // Varje försök räknas, som i mem_arena_alloc
+    MemHandle* handle = (MemHandle*)malloc(sizeof(MemHandle));
+    if (handle == NULL || size > MAX_REQUEST_SIZE) {
+        printf("Failed to allocate handle.\n");
+        free(handle);
+        count_event(arena, NULL, COUNT_FAILED, 1);
+        return NULL;
+    }
+
+    pthread_mutex_lock(&arena->lock);
+    void* address = pool_alloc(arena, size > 0 ? size : 1, MEM_ALIGNMENT);
+    Block* block = address != NULL ? table_take(arena, address) : NULL;
+    if (block == NULL) {
+        pthread_mutex_unlock(&arena->lock);
+        free(handle);
+        count_event(arena, NULL, COUNT_FAILED, 1);
+        return NULL;
+    }
+    block->handle = handle;
+    handle->arena = arena;
+    handle->block = block;
+    handle->lock_count = 0;
+    handle->prev = NULL;
+    handle->next = arena->handles;
+    if (arena->handles != NULL) {
+        arena->handles->prev = handle;
+    }
+    arena->handles = handle;
+    pthread_mutex_unlock(&arena->lock);
+    return handle;
+}
+
+// Funktion för att allokera ett flyttbart block i standardpoolen
+MemHandle* mem_handle_alloc(size_t size) {
+    return mem_arena_handle_alloc(&default_arena, size);
+}
+
+// Funktion för att låsa ett flyttbart block på sin plats. Returnerar blockets adress,
+// som gäller tills blocket låses upp lika många gånger som det har låsts.
+void* mem_handle_lock(MemHandle* handle) {
+    if (handle == NULL) {
+        return NULL;
+    }
+    MemArena* arena = handle->arena;
+    pthread_mutex_lock(&arena->lock);
+    handle->lock_count++;
+    void* address = handle->block->address;
+    pthread_mutex_unlock(&arena->lock);
+    return address;
+}
+
+// Funktion för att släppa ett lås på ett flyttbart block
+void mem_handle_unlock(MemHandle* handle) {
+    if (handle == NULL) {
+        return;
+    }
+    MemArena* arena = handle->arena;
+    pthread_mutex_lock(&arena->lock);
+    if (handle->lock_count == 0) {
+        printf("Handle is not locked.\n");
+    } else {
+        handle->lock_count--;
+    }
+    pthread_mutex_unlock(&arena->lock);
+}
+
+// Funktion för att frigöra ett flyttbart block och dess handtag
+void mem_handle_free(MemHandle* handle) {
+    if (handle == NULL) {
+        return;
+    }
+    MemArena* arena = handle->arena;
+    pthread_mutex_lock(&arena->lock);
+    if (arena->compact_cursor == handle) {
+        arena->compact_cursor = NULL;  // Kompakteringen börjar om från områdets början
+    }
+    if (handle->prev != NULL) {
+        handle->prev->next = handle->next;
+    } else {
+        arena->handles = handle->next;
+    }
+    if (handle->next != NULL) {
+        handle->next->prev = handle->prev;
+    }
+    handle->block->handle = NULL;
+    block_release(arena, handle->block);
+    pthread_mutex_unlock(&arena->lock);
+    count_event(arena, NULL, COUNT_FREES, 1);
+    free(handle);
+}
+
+// Funktion för att flytta ett flyttbart block till början av det lediga blocket framför
+// det. Det lediga blocket hamnar efter det flyttade och slås ihop med nästa block om
+// det också är ledigt. Anroparen håller arenans lås.
+static void compact_slide(MemArena* arena, PoolRegion* region, Block* free_block, Block* moved) {
+    memmove(free_block->address, moved->address, moved->size);
+    bin_remove(arena, free_block);
+
+    // Byt plats på blocken i områdets lista
+    Block* prev = free_block->prev;
+    Block* next = moved->next;
+    moved->address = free_block->address;
+    free_block->address = (char*)moved->address + moved->size;
+    moved->prev = prev;
+    moved->next = free_block;
+    free_block->prev = moved;
+    free_block->next = next;
+    if (prev != NULL) {
+        prev->next = moved;
+    } else {
+        region->head = moved;
+        if (arena == &default_arena && region == &arena->regions[0]) {
+            head_pool = moved;
+        }
+    }
+    if (next != NULL) {
+        next->prev = free_block;
+    }
+
+    // Det flyttade blocket rörde en del av sidorna, så blocket räknas inte längre som tömt
+    free_block->is_purged = false;
+    if (next != NULL && next->is_free) {
+        bin_remove(arena, next);
+        free_block->size += next->size;
+        free_block->next = next->next;
+        if (next->next != NULL) {
+            next->next->prev = free_block;
+        }
+        descriptor_free(arena, next);
+    }
+    bin_insert(arena, free_block);
+}
+
+// Funktion för att läsa en monoton klocka i mikrosekunder
+static uint64_t now_us(void) {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (uint64_t)now.tv_sec * 1000000 + (uint64_t)now.tv_nsec / 1000;
+}
+
+// Funktion för att kompaktera en arena stegvis. Olåsta flyttbara block skjuts mot
+// början av sitt område, ett område i taget, tills 'budget_us' mikrosekunder har gått.
+// Minst ett block flyttas per anrop om något går att flytta. Nästa anrop fortsätter där
+// det här slutade. Returnerar true när ett helt varv över poolen är klart.
+bool mem_arena_compact(MemArena* arena, unsigned budget_us) {
+    arena = arena_or_default(arena);
+    if (arena->options.placement == MEM_PLACEMENT_BUDDY) {
+        return true;  // Kompisarnas adresser bestämmer vilka block som kan slås ihop, så inget flyttas
+    }
+    pthread_mutex_lock(&arena->lock);
+    uint64_t deadline = now_us() + budget_us;
+    size_t steps = 0;
+    while (arena->compact_region < arena->region_count) {
+        PoolRegion* region = &arena->regions[arena->compact_region];
+        Block* current = arena->compact_cursor != NULL ? arena->compact_cursor->block : region->head;
+        while (current != NULL) {
+            Block* next = current->next;
+            bool moved = false;
+            if (current->is_free && next != NULL && next->handle != NULL && next->handle->lock_count == 0) {
+                // Blocket efter ett ledigt block flyttas ner, och det lediga blocket står
+                // kvar som nästa att undersöka
+                compact_slide(arena, region, current, next);
+                arena->compact_cursor = next->handle;
+                moved = true;
+            } else {
+                if (current->handle != NULL) {
+                    arena->compact_cursor = current->handle;
+                }
+                current = next;
+            }
+            if ((moved || ++steps % 64 == 0) && now_us() >= deadline) {
+                pthread_mutex_unlock(&arena->lock);
+                return false;
+            }
+        }
+        arena->compact_region++;
+        arena->compact_cursor = NULL;
+    }
+
+    // Varvet är klart, och nästa anrop börjar om från poolens början
+    arena->compact_region = 0;
+    arena->compact_cursor = NULL;
+    pthread_mutex_unlock(&arena->lock);
+    return true;
+}
+
+// Funktion för att kompaktera standardpoolen stegvis
+bool mem_compact(unsigned budget_us) {
+    return mem_arena_compact(&default_arena, budget_us);
+}
+
+// Funktion för att frigöra ett block
+void mem_free(void* block) {
+#ifdef MEM_TRACE
+    trace_free(block);
+#endif
+    mem_arena_free(&default_arena, block);
+}
+
+// Funktion för att lämna tillbaka den anropande trådens tomma spann, arenans stackar
+// av tomma spann och tomma kornspann till poolen, till exempel innan en tråd blir
+// vilande eller innan fragmenteringen mäts
+void mem_flush_cache(void) {
+    MemArena* arena = &default_arena;
+    if (!arena->granules_enabled) {
+        return;
+    }
+    ThreadHeap* heap = arena->caches_enabled ? find_thread_heap(arena) : NULL;
+    if (heap != NULL) {
+        heap_drain_remote(heap);
+    }
+    pthread_mutex_lock(&arena->lock);
+    if (heap != NULL) {
+        heap_trim(heap);
+    }
+    arena_release_span_stacks(arena);
+    granule_trim(arena);
+    pthread_mutex_unlock(&arena->lock);
+}
+
+// Funktion för att lämna tillbaka alla hela lediga sidor i en arena till operativsystemet,
+// oavsett tröskel och avklingning. Den anropande trådens och arenans tomma spann släpps först.
+// Returnerar antalet byte som lämnades tillbaka.
+size_t mem_arena_trim(MemArena* arena) {
+    arena = arena_or_default(arena);
+    ThreadHeap* heap = arena->caches_enabled ? find_thread_heap(arena) : NULL;
+    if (heap != NULL) {
+        heap_drain_remote(heap);
+    }
+
+    pthread_mutex_lock(&arena->lock);
+    if (heap != NULL) {
+        heap_trim(heap);
+    }
+    arena_release_span_stacks(arena);
+    granule_trim(arena);
+    size_t released = arena->region_count > 0 ? arena_purge(arena, 0, UINT64_MAX) : 0;
+    pthread_mutex_unlock(&arena->lock);
+    return released;
+}
+
+// Funktion för att lämna tillbaka standardarenans lediga sidor till operativsystemet
+size_t mem_trim(void) {
+    return mem_arena_trim(&default_arena);
+}
+
+// Funktion för att mäta fragmenteringen av det lediga minnet.
+// Returnerar 0 när allt ledigt minne ligger i ett block och närmar sig 1 ju mer
+// det är uppsplittrat i små block.
+double mem_fragmentation(void) {
+    MemArena* arena = &default_arena;
+    pthread_mutex_lock(&arena->lock);
+    double fragmentation = 0.0;
+    if (arena->free_bytes > 0) {
+        fragmentation = 1.0 - (double)largest_free(arena) / (double)arena->free_bytes;
+    }
+    pthread_mutex_unlock(&arena->lock);
+    return fragmentation;
+}
+
+// Funktion för att hämta statistik för en arena. Allt kommer från räknare som hålls
+// uppdaterade löpande; bara den högsta storleksklassen gås igenom för det största blocket.
+MemStats mem_arena_get_stats(MemArena* arena) {
+    arena = arena_or_default(arena);
+    MemStats stats;
+    memset(&stats, 0, sizeof(stats));
+
+    pthread_mutex_lock(&arena->lock);
+    int64_t counts[NUM_COUNTERS];
+    for (int counter = 0; counter < NUM_COUNTERS; counter++) {
+        counts[counter] = __atomic_load_n(&arena->counts[counter], __ATOMIC_RELAXED);
+    }
+    for (ThreadHeap* heap = arena->heaps; heap != NULL; heap = heap->next_in_arena) {
+        for (int counter = 0; counter < NUM_COUNTERS; counter++) {
+            counts[counter] += __atomic_load_n(&heap->counts[counter], __ATOMIC_RELAXED);
+        }
+    }
+
+    // Spannen räknas som upptagna block i poolen, men bara deras utdelade objekt är i bruk
+    size_t block_bytes = arena->pool_size - arena->free_bytes - arena->span_bytes;
+    stats.pool_size = arena->pool_size;
+    stats.bytes_in_use = block_bytes + (counts[COUNT_SMALL_BYTES] > 0 ? (size_t)counts[COUNT_SMALL_BYTES] : 0);
+    stats.bytes_free = stats.pool_size - stats.bytes_in_use;
+    stats.free_blocks = arena->free_blocks;
+    stats.largest_free_block = largest_free(arena);
+    stats.alloc_count = (uint64_t)counts[COUNT_ALLOCS];
+    stats.free_count = (uint64_t)counts[COUNT_FREES];
+    stats.resize_count = (uint64_t)counts[COUNT_RESIZES];
+    stats.failed_allocs = (uint64_t)counts[COUNT_FAILED];
+    stats.avg_search_length = arena->searches > 0 ? (double)arena->search_steps / (double)arena->searches : 0.0;
+    stats.max_search_length = arena->max_search;
+    stats.buddy_slack = arena->buddy_slack;
+    stats.internal_fragmentation = block_bytes > 0 ? (double)arena->buddy_slack / (double)block_bytes : 0.0;
+    pthread_mutex_unlock(&arena->lock);
+    return stats;
+}
+
+// Funktion för att hämta statistik för standardarenan
+MemStats mem_get_stats(void) {
+    return mem_arena_get_stats(&default_arena);
+}
+
+// Funktion för att skapa en objektpool för objekt på 'object_size' byte i en arena.
+// Objekten hamnar 'align' byte isär eller mer, tätt packade i skivor som allokeras ur
+// arenan. Metadata ligger utanför arenan, precis som arenornas egna tabeller.
+MemObjectPool* mem_object_pool_create(MemArena* arena, size_t object_size, size_t align) {
+    if (align == 0) {
+        align = MEM_ALIGNMENT;
+    }
+    if ((align & (align - 1)) != 0) {
+        printf("Invalid alignment.\n");
+        return NULL;
+    }
+    if (object_size == 0 || object_size > MAX_REQUEST_SIZE) {
+        printf("Invalid object size.\n");
+        return NULL;
+    }
+
+    MemObjectPool* pool = (MemObjectPool*)calloc(1, sizeof(MemObjectPool));
+    if (pool == NULL) {
+        printf("Failed to allocate object pool.\n");
+        return NULL;
+    }
+    // Ett ledigt objekt rymmer länken i den fria listan
+    size_t size = object_size > sizeof(void*) ? object_size : sizeof(void*);
+    pool->arena = arena_or_default(arena);
+    pool->stride = (size + align - 1) & ~(align - 1);
+    pool->align = align;
+    pool->next_slab_objects = MIN_SLAB_OBJECTS;
+    return pool;
+}
+
+// Funktion för att allokera en ny skiva när alla objekt i den senaste är utdelade.
+// Skivorna dubblas i storlek, men krymps till det största lediga blocket i arenan så
+// att en pool med exakt storlek fylls helt.
+static bool object_pool_grow(MemObjectPool* pool) {
+    if (pool->slab_count == pool->slab_capacity) {
+        size_t capacity = pool->slab_capacity > 0 ? pool->slab_capacity * 2 : 8;
+        void** slabs = (void**)realloc(pool->slabs, capacity * sizeof(void*));
+        if (slabs == NULL) {
+            return false;
+        }
+        pool->slabs = slabs;
+        pool->slab_capacity = capacity;
+    }
+
+    size_t objects = pool->next_slab_objects;
+    pthread_mutex_lock(&pool->arena->lock);
+    size_t fits = largest_free(pool->arena) / pool->stride;
+    pthread_mutex_unlock(&pool->arena->lock);
+    if (fits < objects) {
+        objects = fits > 0 ? fits : 1;  // En pool som kan växa får ändå försöka
+    }
+    char* slab = (char*)mem_arena_alloc_aligned(pool->arena, objects * pool->stride, pool->align);
+    if (slab == NULL) {
+        return false;
+    }
+    pool->slabs[pool->slab_count++] = slab;
+    pool->carve = slab;
+    pool->carve_end = slab + objects * pool->stride;
+    if (pool->next_slab_objects < MAX_SLAB_OBJECTS) {
+        pool->next_slab_objects *= 2;
+    }
+    return true;
+}
+
+// Funktion för att allokera ett objekt ur poolen. Frigjorda objekt återanvänds först,
+// annars tas nästa objekt från den senaste skivan.
+void* mem_object_pool_alloc(MemObjectPool* pool) {
+    void* object = pool->free_list;
+    if (object != NULL) {
+        pool->free_list = *(void**)object;
+        return object;
+    }
+    if (pool->carve == pool->carve_end && !object_pool_grow(pool)) {
+        return NULL;
+    }
+    object = pool->carve;
+    pool->carve += pool->stride;
+    return object;
+}
+
+// Funktion för att lämna tillbaka ett objekt till poolen
+void mem_object_pool_free(MemObjectPool* pool, void* object) {
+    if (object == NULL) {
+        return;
+    }
+    *(void**)object = pool->free_list;  // Länken lagras i det lediga objektet
+    pool->free_list = object;
+}
+
+// Funktion för att riva en objektpool. Skivorna går tillbaka till arenan.
+void mem_object_pool_destroy(MemObjectPool* pool) {
+    if (pool == NULL) {
+        return;
+    }
+    for (size_t i = 0; i < pool->slab_count; i++) {
+        mem_arena_free(pool->arena, pool->slabs[i]);
+    }
+    free(pool->slabs);
+    free(pool);
+}
+
+// Funktion för att ändra storleken på ett objekt i ett spann
+static void* small_resize(MemArena* arena, ThreadHeap* heap, Span* span, void* block, size_t size) {
+    // Ett objekt i ett kornspann är så stort som sin följd av korn, som läses under låset
+    size_t object_size = span->object_size;
+    if (span->is_granular) {
+        pthread_mutex_lock(&arena->lock);
+        object_size = granule_run(span, block) * SMALL_OBJECT_STEP;
+        pthread_mutex_unlock(&arena->lock);
+        if (object_size == 0) {
+            printf("Block not found for resizing.\n");
+            return NULL;
+        }
+    } else {
+        // Objektet måste vara utdelat; ägaren kan kontrollera det utan lås
+        size_t index = span_index(span, block);
+        if (index >= span->capacity ||
+            (span_owner(span) == heap && (span->allocated[index / 64] & (1ULL << (index % 64))) == 0)) {
+            printf("Block not found for resizing.\n");
+            return NULL;
+        }
+    }
+
+    // Storleken ryms redan i objektet
+    if (size <= object_size) {
+        return block;
+    }
+
+    ThreadHeap* alloc_heap;
+    void* new_block = arena_alloc(arena, size, &alloc_heap);
+    if (new_block == NULL) {
+        count_event(arena, heap, COUNT_FAILED, 1);
+        return NULL;
+    }
+    memcpy(new_block, block, object_size);
+    small_free(arena, heap, span, block);
+    return new_block;
+}
+
+// Funktion för att ändra storleken på ett allokerat block i en arena
+void* mem_arena_resize(MemArena* arena, void* block, size_t size) {
+    arena = arena_or_default(arena);
+    ThreadHeap* heap = arena->caches_enabled ? find_thread_heap(arena) : NULL;
+    count_event(arena, heap, COUNT_RESIZES, 1);
+    if (size > MAX_REQUEST_SIZE) {
+        printf("No suitable block found.\n");
+        count_event(arena, heap, COUNT_FAILED, 1);
+        return NULL;
+    }
+
+    // En adress från en allokering på noll byte får ett nytt block. Ligger ett levande block
+    // på samma adress kopieras det, eftersom anroparen kan ha menat det blocket.
+    if (zero_free(arena, block)) {
+        size_t live = live_size(arena, block);
+        ThreadHeap* alloc_heap;
+        void* result = arena_alloc(arena, size, &alloc_heap);
+        if (result == NULL) {
+            // Adressen gäller fortfarande, precis som blocket när en vanlig storleksändring misslyckas
+            pthread_mutex_lock(&arena->lock);
+            zero_add(arena, block);
+            pthread_mutex_unlock(&arena->lock);
+            count_event(arena, heap, COUNT_FAILED, 1);
+        } else if (size > 0 && live > 0) {
+            memcpy(result, block, size < live ? size : live);
+        }
+        return result;
+    }
+
+    Span* span = span_of(arena, block);
+    if (span != NULL) {
+        return small_resize(arena, heap, span, block, size);
+    }
+
+    pthread_mutex_lock(&arena->lock);
+
+    // Slå upp blocket i adresstabellen
+    Block* current = table_get(arena, block);
+    if (current == NULL) {
+        // Om blocket inte hittas, skriv ut ett felmeddelande
+        pthread_mutex_unlock(&arena->lock);
+        printf("Block not found for resizing.\n");
+        return NULL;
+    }
+
+    // Ett block som krymper behåller minst MEM_ALIGNMENT byte. Ett block på noll byte
+    // skulle ligga kvar i adresstabellen på samma adress som det lediga minnet efter sig.
+    size_t keep = size > 0 ? align_up(size) : MEM_ALIGNMENT;
+
+    // Med buddy-placering halveras blocket så länge halvan räcker, och övre halvan blir ledig.
+    // Blocket växer aldrig på plats, eftersom grannen efter inte behöver vara dess kompis.
+    if (arena->options.placement == MEM_PLACEMENT_BUDDY && current->size >= size) {
+        while (current->size / 2 >= buddy_size(keep, 1) && split_block(arena, current, current->size / 2)) {
+            arena->free_bytes += current->size;
+        }
+        arena->buddy_slack -= current->slack;
+        current->slack = current->size > keep ? current->size - keep : 0;
+        arena->buddy_slack += current->slack;
+        pthread_mutex_unlock(&arena->lock);
+        return block;
+    }
+
+    // Krympning: dela av slutet och lämna tillbaka det till det lediga minnet
+    if (current->size >= size) {
+        size_t released = current->size > keep ? current->size - keep : 0;
+        if (released > 0 && split_block(arena, current, keep)) {
+            arena->free_bytes += released;
+        }
+        pthread_mutex_unlock(&arena->lock);
+        return block;
+    }
+
+    // Växt på plats: ta det som behövs från ett ledigt block direkt efter
+    Block* next = current->next;
+    bool in_place = arena->options.placement != MEM_PLACEMENT_BUDDY;
+    if (in_place && next != NULL && next->is_free && current->size + next->size >= size) {
+        // Det sista blocket i poolen kan vara mindre än den avrundade storleken
+        size_t target = align_up(size) < current->size + next->size ? align_up(size) : current->size + next->size;
+        size_t extra = target - current->size;
+        bin_remove(arena, next);
+        arena->free_bytes -= extra;
+        if (next->size > extra) {
+            // Det lediga blocket flyttas fram och krymper
+            next->address = (char*)next->address + extra;
+            next->size -= extra;
+            current->size = target;
+            bin_insert(arena, next);
+        } else {
+            // Hela det lediga blocket går åt
+            current->size += next->size;
+            current->next = next->next;
+            if (next->next != NULL) {
+                next->next->prev = current;
+            }
+            descriptor_free(arena, next);
+        }
+        pthread_mutex_unlock(&arena->lock);
+        return block;
+    }
+
+    // Sista utvägen: allokera ett nytt block med den önskade storleken
+    void* new_block = pool_alloc(arena, size, MEM_ALIGNMENT);
+    if (new_block != NULL) {
+        // Kopiera data från det gamla blocket till det nya och frigör det gamla
+        memcpy(new_block, block, current->size);
+        table_take(arena, block);
+        block_release(arena, current);
+    }
+    pthread_mutex_unlock(&arena->lock);
+    if (new_block == NULL) {
+        count_event(arena, heap, COUNT_FAILED, 1);
+    }
+    return new_block; // Returnera adressen till det nya blocket, eller NULL om allokeringen misslyckades
+}
+
+// Funktion för att ändra storleken på ett allokerat block
+void* mem_resize(void* block, size_t size) {
+#ifdef MEM_TRACE
+    return trace_resize(block, size);
+#else
+    return mem_arena_resize(&default_arena, block, size);
+#endif
+}
+
+// Funktion för att avinitiera minneshanteraren
+void mem_deinit() {
+#ifdef MEM_TRACE
+    trace_reset();
+#endif
+    arena_teardown(&default_arena);
+    memory_pool = NULL;
+    head_pool = NULL;
+}
+
+
+
+
+
+
+
+
+
+
+
+
+
+
+
+
+
+
+
+
+
+
+/*
+#include "memory_manager.h"
+
+
+
+// Function to initialize the memory pool
+void mem_init(size_t size) {
+    // Allocate the memory pool with the specified size
+    memory_pool = malloc(size);
+    if (memory_pool == NULL) {
+        printf("Failed to allocate memory pool.\n");  // Error handling if allocation fails
+        return;
+    }
+
+    // Create an initial block representing the entire pool
+    head_pool = (Block*)malloc(sizeof(Block));
+    if (head_pool == NULL) {
+        printf("Failed to allocate head block.\n");  // Error handling if block allocation fails
+        return;
+    }
+
+    // Initialize first block
+    head_pool->address = memory_pool;
+    head_pool->size = size;
+    head_pool->is_free = true;  // The block is marked as free
+    head_pool->next = NULL;
+}
+
+// Function to allocate memory from the pool
+void* mem_alloc(size_t size) {
+    Block* current = head_pool;  // Start with first block
+
+    // Loop through the blocks until a large enough free block is found
+    while (current != NULL) {
+        if (current->is_free && current->size >= size) {
+            // If a free block of sufficient size is found, mark it as not free
+            current->is_free = false;
+
+            // If the block is larger than needed, split it into two blocks
+            if (current->size > size) {
+                Block* new_block = (Block*)malloc(sizeof(Block));
+                new_block->address = current->address + size;
+                new_block->size = current->size - size; // New block size is remaining space
+                new_block->is_free = true;  // The new block is free
+                new_block->next = current->next;  // The new block points to the next block in the list
+                // Update the size of the allocated block and associate the new block
+                current->size = size;
+                current->next = new_block;
+            }
+
+            return current->address; // Return the address of the allocated block
+        }
+        current = current->next;  // Go to the next block
+    }
+    // If no matching block is found, print an error message and return NULL
+    printf("No suitable block found.\n");
+    return NULL; 
+}
+
+// Function to free a block
+void mem_free(void* block) {
+    Block* current = head_pool; // Start with first block
+
+     // Loop through the blocks to find the one corresponding to the given address
+    while (current != NULL) {
+        if (current->address == block) {
+            current->is_free = true; // Mark the block as free
+            
+            // Check if the next block is also free and merge them to reduce fragmentation
+            if (current->next != NULL && current->next->is_free) {
+                current->size += current->next->size;  // Add the size of the next block
+                Block* temp = current->next;  // Temporary pointer to free the next block
+                current->next = current->next->next;  // Skip the next block in the list
+                free(temp);  // Free the memory for the merged block
+            }
+            return;
+        }
+        current = current->next;  // Go to the next block
+    }
+    printf("Block not found.\n"); // If the block is not found, print an error message
+}
+
+// Function to resize an allocated block
+void* mem_resize(void* block, size_t size) {
+    Block* current = head_pool;
+
+    // Loop through the blocks to find the one corresponding to the given address
+    while (current != NULL) {
+        if (current->address == block) {
+            // If the current block is already large enough, return the same block
+            if (current->size >= size) {
+                return block;
+            }
+            // Otherwise, allocate a new block of the desired size
+            void* new_block = mem_alloc(size);
+            if (new_block == NULL) {
+                return NULL; // If the allocation fails, return NULL
+            }
+
+            // Copy the data from the old block to the new one
+            memcpy(new_block, block, current->size);
+            mem_free(block);  // Free the old block
+            return new_block;  // Return the address of the new block
+        }
+        current = current->next;  // Go to the next block
+    }
+    printf("Block not found for resizing.\n");  // If the block is not found, print an error message
+    return NULL;
+}
+
+// Function to uninitialize the memory manager
+void mem_deinit() {
+    free(memory_pool); // 
+    memory_pool = NULL;
+
+    // Free all blocks in the linked list
+    Block* current = head_pool;
+    while (current != NULL) {
+        Block* temp = current; // Temporary pointer to hold the block to be freed
+        current = current->next; 
+        free(temp); // Free current block
+    }
+    head_pool = NULL;  // Reset head_pool when all blocks are freed
+}*/
+
@@ -1,37 +1,198 @@
-#ifndef MEMORY_MANAGER_H  
-#define MEMORY_MANAGER_H  
-
-#include <stdio.h>  // Includes standard input and output functions
-#include <string.h>  // Includes string handling functions
-#include <stdint.h>  // Includes standardized integer types
-#include <stddef.h>  // Includes standard definitions, including the size type size_t
-#include <stdbool.h>  // Includes boolean type and true/false constants
-#include <stdlib.h>  // Includes functions for memory management and conversion
-
-
-// Defines the size of the memory pool (80 MB)
-#define POOL_SIZE 81920000 
-// Defines the maximum number of blocks that can be created
-#define MAX_BLOCKS 100000      
-
-// Structure representing a block of memory
-typedef struct Block {
-    void* address;  // Pointer to the block's starting address
-    size_t size;   // Size of the block in bytes
-    bool is_free;  // Flag indicating whether the block is free or busy
-    struct Block* next; // Pointer to the next block in the linked list
-} Block;
-
-
-void* memory_pool; // Pointer to the entire memory pool
-Block* head_pool;  // Pointer to the first block in the linked list of blocks
-
-void mem_init(size_t size);
-void* mem_alloc(size_t size);
-void mem_free(void* block);
-void* mem_resize(void* block, size_t size);
-void mem_deinit(void);
-
-#endif 
-
-
+#ifndef MEMORY_MANAGER_H  
+#define MEMORY_MANAGER_H  
+
+#include <stdio.h>  // Includes standard input and output functions
+#include <string.h>  // Includes string handling functions
+#include <stdint.h>  // Includes standardized integer types
+#include <stddef.h>  // Includes standard definitions, including the size type size_t
+#include <stdbool.h>  // Includes boolean type and true/false constants
+#include <stdlib.h>  // Includes functions for memory management and conversion
+
+
+// Defines the size of the memory pool (80 MB)
+#define POOL_SIZE 81920000 
+// Defines the maximum number of blocks that can be created
+#define MAX_BLOCKS 100000      
+// Every block starts on a multiple of MEM_ALIGNMENT bytes. Can be raised at build
+// time (e.g. -DMEM_ALIGNMENT=64); it must be a power of two of at least 16.
+#ifndef MEM_ALIGNMENT
+#define MEM_ALIGNMENT 16
+#endif
+
+// Structure representing a block of memory
+typedef struct Block {
+    void* address;  // Pointer to the block's starting address
+    size_t size;   // Size of the block in bytes
+    bool is_free;  // Flag indicating whether the block is free or busy
+    struct Block* next; // Pointer to the next block in the linked list
+    struct Block* prev; // Pointer to the previous block in the linked list
+    size_t free_slot;        // Position in its size class's free vectors, SIZE_MAX when not in one
+    bool is_purged;          // The whole pages inside this free block have been returned to the OS
+    uint64_t freed_at;       // When a large free block was freed (ms), used by the trim decay
+    struct MemHandle* handle; // Handle that owns this block and may move it, NULL for ordinary blocks
+    struct Block* tree_left;  // Smaller free blocks in the best-fit size tree
+    struct Block* tree_right; // Larger free blocks in the best-fit size tree
+    size_t slack;             // Bytes the block was rounded up beyond its request under buddy placement
+} Block;
+
+
+void* memory_pool; // Pointer to the entire memory pool
+Block* head_pool;  // Pointer to the first block in the linked list of blocks
+
+// Where the pool memory comes from. Anonymous mmap memory is page aligned and only
+// committed when touched. Huge pages cut TLB misses on large, randomly accessed pools:
+// MAP_HUGETLB is tried first (needs pages reserved via vm.nr_hugepages), then
+// transparent huge pages through madvise(MADV_HUGEPAGE), then plain mmap.
+typedef enum MemBacking {
+    MEM_BACKING_MALLOC,      // Pool taken from the C heap (default)
+    MEM_BACKING_MMAP,        // Anonymous mmap region with normal pages
+    MEM_BACKING_HUGE_PAGES   // Anonymous mmap region with huge pages where available
+} MemBacking;
+
+// How a free block is chosen for a request. Size classes take the first block that fits
+// in the smallest non-empty class that can hold the request. Next-fit continues the walk
+// over the blocks in address order where the previous search stopped, so allocations
+// spread over the pool instead of piling up at its start. Best-fit takes the smallest
+// block that fits, lowest address first, from a tree ordered by size; it leaves the
+// least slack but updates the tree on every change to the free blocks. TLSF splits each
+// power-of-two class into 16 finer classes and takes the head of the first non-empty
+// class above the request, found with two bit scans, so a search costs the same however
+// fragmented the pool is, at the price of up to 1/16 extra slack. Buddy rounds every
+// block up to a power of two that starts at a multiple of its size from the region
+// start, so a freed block finds its buddy by XOR of its offset with its size and merges
+// with it, order by order, while the buddy is free; splits and merges take O(log n)
+// steps. Buddy blocks do not grow in place, are not moved by mem_compact, and MemStats
+// reports what the rounding costs. Under the other placements, requests whose alignment
+// needs padding always search the size classes.
+typedef enum MemPlacement {
+    MEM_PLACEMENT_SIZE_CLASSES,  // Segregated first fit (default)
+    MEM_PLACEMENT_NEXT_FIT,      // Roving pointer over the blocks in address order
+    MEM_PLACEMENT_BEST_FIT,      // Smallest fitting block from a size-ordered tree
+    MEM_PLACEMENT_TLSF,          // Two-level segregated fit, constant-time good fit
+    MEM_PLACEMENT_BUDDY          // Binary buddy blocks with per-order free lists
+} MemPlacement;
+
+// Options for mem_init_with_options and mem_arena_create_with_options. A zeroed
+// struct, or NULL, gives the defaults.
+//
+// A pool normally has the fixed size given at init. With max_size above that size it
+// grows on demand by mapping further regions, each at least as large as the pool so
+// far, until max_size is reached. Blocks coalesce only within their own region.
+//
+// Free pages can be returned to the OS with madvise so that RSS follows the live data.
+// With a trim_threshold, free blocks of at least that many bytes are released once they
+// have stayed free for trim_decay_ms (0 releases them as soon as they are freed).
+typedef struct MemOptions {
+    MemBacking backing;        // Requested backing for the pool
+    size_t trim_threshold;     // Smallest free block released automatically, 0 disables
+    unsigned trim_decay_ms;    // How long a large free block stays resident before release
+    bool trim_lazily;          // Use MADV_FREE instead of MADV_DONTNEED where available
+    size_t max_size;           // Hard ceiling for a growing pool, 0 keeps the pool at its initial size
+    MemPlacement placement;    // How free blocks are chosen
+    bool no_small_spans;       // Small blocks bypass thread caches and granule spans
+} MemOptions;
+
+// Allocator statistics from mem_get_stats. The values come from counters that are kept
+// up to date as the pool changes, so reading them does not walk the blocks. The largest
+// size in the top size class is tracked too; only after its largest block was taken is
+// that one class read again, on the next call. Small objects count as in use at their
+// size class; the unused part of the spans cached by threads, and empty spans waiting
+// to be shared between threads, counts as free.
+// Threads update their own counters without locking, so a snapshot taken while other
+// threads run is consistent per counter, not across them.
+typedef struct MemStats {
+    size_t pool_size;           // Total pool size, including regions added by growth
+    size_t bytes_in_use;        // Bytes held by live allocations, after rounding
+    size_t bytes_free;          // pool_size - bytes_in_use
+    size_t largest_free_block;  // Largest free block in the pool
+    size_t free_blocks;         // Number of free blocks in the pool
+    uint64_t alloc_count;       // Allocation attempts, including handles and each block of a batch
+    uint64_t free_count;        // Calls to mem_free
+    uint64_t resize_count;      // Calls to mem_resize
+    uint64_t failed_allocs;     // Allocations and resizes that could not be satisfied
+    double avg_search_length;   // Free blocks examined per search of the pool, on average
+    size_t max_search_length;   // Most free blocks examined by a single search
+    size_t buddy_slack;         // Bytes live blocks were rounded up beyond their requests (buddy placement)
+    double internal_fragmentation; // buddy_slack as a share of the bytes in live pool blocks
+} MemStats;
+
+// An arena is an independent pool with its own blocks, size classes and thread
+// caches. The mem_* functions below operate on a default arena; passing NULL to
+// the mem_arena_* functions selects the same default arena.
+typedef struct MemArena MemArena;
+
+// A checkpoint from mem_mark. mem_release(mark) frees every block allocated in the
+// pool since the mark, by any thread, including blocks moved there by mem_resize,
+// and closes the mark together with any marks opened after it. While a mark is open,
+// small allocations bypass the thread caches so that they can be tracked.
+typedef size_t MemMark;
+#define MEM_MARK_INVALID ((MemMark)0)
+
+// A fixed-size object pool. Objects are carved densely from slabs allocated in an
+// arena, and freed objects are recycled through a free list, so alloc and free are
+// O(1) with no search or split. align is a power of two, 0 selects MEM_ALIGNMENT.
+// A pool is not thread-safe; give each thread its own or lock around it.
+typedef struct MemObjectPool MemObjectPool;
+
+// A relocatable block. The pool may move the block while it is unlocked, so its address
+// is only valid between mem_handle_lock and the matching mem_handle_unlock; locks nest.
+// mem_compact slides unlocked handle blocks towards the start of their region until
+// budget_us microseconds have passed, and returns true once a whole pass has finished;
+// call it again to continue. Ordinary blocks never move, and mem_free, mem_resize and
+// mem_release do not accept handle blocks. mem_reset frees every handle.
+typedef struct MemHandle MemHandle;
+
+// mem_alloc, mem_free and mem_resize may be called from any thread. mem_init and
+// mem_deinit must not run concurrently with other calls. The same holds for an
+// arena and mem_arena_create/mem_arena_destroy.
+void mem_init(size_t size);      // Calling it again tears down the previous default pool
+void mem_init_with_options(size_t size, const MemOptions* options);
+void* mem_alloc(size_t size);     // Size 0 reserves nothing; mem_free on that address frees no block
+void* mem_alloc_aligned(size_t size, size_t align); // align is a power of two, e.g. 64 or 4096
+void mem_free(void* block);
+size_t mem_alloc_batch(size_t count, size_t size, void** out); // Returns how many were allocated, the rest of out is NULL
+void mem_free_batch(void** blocks, size_t count);    // Coalesces neighbours once per run, skips NULL entries
+void* mem_resize(void* block, size_t size);
+void mem_deinit(void);
+double mem_fragmentation(void); // 0 when all free memory is one block, towards 1 when scattered
+void mem_flush_cache(void);     // Returns the calling thread's and the shared empty spans to the pool
+size_t mem_trim(void);          // Returns all free whole pages to the OS, returns bytes released
+MemStats mem_get_stats(void);
+void mem_reset(void);            // Frees every block at once; must not run concurrently with other calls
+MemMark mem_mark(void);          // Returns MEM_MARK_INVALID if the mark cannot be recorded
+void mem_release(MemMark mark);
+MemHandle* mem_handle_alloc(size_t size);  // Returns NULL if the block cannot be allocated
+void* mem_handle_lock(MemHandle* handle);  // Pins the block and returns its current address
+void mem_handle_unlock(MemHandle* handle);
+void mem_handle_free(MemHandle* handle);
+bool mem_compact(unsigned budget_us);
+
+MemArena* mem_arena_create(size_t size);  // Returns NULL if the pool cannot be allocated
+MemArena* mem_arena_create_with_options(size_t size, const MemOptions* options);
+void* mem_arena_alloc(MemArena* arena, size_t size);
+void* mem_arena_alloc_aligned(MemArena* arena, size_t size, size_t align);
+void mem_arena_free(MemArena* arena, void* block);
+size_t mem_arena_alloc_batch(MemArena* arena, size_t count, size_t size, void** out);
+void mem_arena_free_batch(MemArena* arena, void** blocks, size_t count);
+void* mem_arena_resize(MemArena* arena, void* block, size_t size);
+void mem_arena_destroy(MemArena* arena);  // Releases the pool and every block in it at once
+size_t mem_arena_trim(MemArena* arena);
+MemArena* mem_arena_of(void* block);      // Arena whose pool contains block, or NULL
+void mem_arena_set_user_data(MemArena* arena, void* data); // Caller's pointer, kept until destroy
+void* mem_arena_user_data(MemArena* arena);
+MemBacking mem_arena_backing(MemArena* arena); // Backing actually obtained, after any fallback
+MemStats mem_arena_get_stats(MemArena* arena);
+void mem_arena_reset(MemArena* arena);
+MemMark mem_arena_mark(MemArena* arena);
+void mem_arena_release(MemArena* arena, MemMark mark);
+MemHandle* mem_arena_handle_alloc(MemArena* arena, size_t size);
+bool mem_arena_compact(MemArena* arena, unsigned budget_us);
+
+MemObjectPool* mem_object_pool_create(MemArena* arena, size_t object_size, size_t align);
+void* mem_object_pool_alloc(MemObjectPool* pool);           // Returns NULL when the arena is full
+void mem_object_pool_free(MemObjectPool* pool, void* object);
+void mem_object_pool_destroy(MemObjectPool* pool);          // Returns every slab to the arena
+
+#endif 
+
+
@@ -161,7 +161,7 @@ void test_list_display()
 
     char *stringFull = malloc(1024);
     char *string2Last = malloc(1024);
-    char *string1third = malloc(1024);
+    char *string1third = calloc(1, 1024);
     char *stringRandom = malloc(1024);
 
     sprintf(stringFull, "[");
@@ -259,7 +259,7 @@ void test_list_display()
 
 #endif
 
-    char *blob = malloc(1024);
+    char *blob = calloc(1, 1024);
     strncpy(blob, start, LenToLast - LenToFirst);
 
     sprintf(stringRandom, "[%s", blob);
@@ -472,6 +472,126 @@ void test_list_edge_cases()
     printf_green("[PASS].\n");
 }
 
+// Two lists with exact-size pools must not share or tear down each other's memory
+void test_list_independent_lists()
+{
+    printf_yellow("  Testing independent lists ---> ");
+    Node *first = NULL;
+    Node *second = NULL;
+    list_init(&first, sizeof(Node) * 2);
+    list_init(&second, sizeof(Node) * 2);
+
+    list_insert(&first, 1);
+    list_insert(&first, 2);
+    list_insert(&second, 3);
+    list_insert(&second, 4);
+    my_assert(list_count_nodes(&first) == 2);
+    my_assert(list_count_nodes(&second) == 2);
+
+    // The first list is full, and cleaning it up leaves the second one intact
+    list_insert_after(first, 5);
+    my_assert(list_count_nodes(&first) == 2);
+    list_cleanup(&first);
+    my_assert(second->data == 3);
+    my_assert(second->next->data == 4);
+
+    list_cleanup(&second);
+    printf_green("[PASS].\n");
+}
+
+// Many lists at once, cleaned up out of order, and a copy of a list's head
+void test_list_many_lists()
+{
+    printf_yellow("  Testing many lists and a copied head ---> ");
+    Node *heads[40];
+    for (int i = 0; i < 40; i++)
+    {
+        list_init(&heads[i], sizeof(Node) * 4);
+        list_insert(&heads[i], (uint16_t)i);
+    }
+
+    // Every other list is cleaned up, and the rest still find their own arenas
+    for (int i = 0; i < 40; i += 2)
+    {
+        list_cleanup(&heads[i]);
+        my_assert(heads[i] == NULL);
+    }
+    for (int i = 1; i < 40; i += 2)
+    {
+        list_insert(&heads[i], (uint16_t)(i + 100));
+        my_assert(list_count_nodes(&heads[i]) == 2);
+        my_assert(heads[i]->data == i);
+        my_assert(heads[i]->next->data == i + 100);
+    }
+
+    // A copy of a non-empty head allocates from the same arena as the original
+    Node *copy = heads[1];
+    list_insert(&copy, 7);
+    list_insert(&copy, 8);
+    my_assert(list_count_nodes(&heads[1]) == 4);
+    list_insert(&copy, 9); // The list's pool holds four nodes
+    my_assert(list_count_nodes(&heads[1]) == 4);
+    list_delete(&copy, 7);
+    my_assert(list_count_nodes(&heads[1]) == 3);
+
+    for (int i = 1; i < 40; i += 2)
+    {
+        list_cleanup(&heads[i]);
+    }
+    printf_green("[PASS].\n");
+}
+
+// A head reused by list_init without list_cleanup must not keep the earlier list's pool
+static void list_leave_uncleaned(int first)
+{
+    Node *head = NULL;
+    list_init(&head, sizeof(Node) * 2);
+    list_insert(&head, (uint16_t)first);
+    list_insert(&head, (uint16_t)(first + 1));
+    // list_cleanup is skipped on purpose
+}
+
+static void list_reuse_head()
+{
+    Node *head = NULL;
+    list_init(&head, sizeof(Node) * 4);
+    my_assert(head == NULL);
+    for (int i = 0; i < 4; i++)
+    {
+        list_insert(&head, (uint16_t)i);
+    }
+    my_assert(list_count_nodes(&head) == 4);
+    my_assert(head->data == 0);
+    list_cleanup(&head);
+}
+
+void test_list_reinit_without_cleanup()
+{
+    printf_yellow("  Testing list_init on a head that was never cleaned up ---> ");
+    Node *head = NULL;
+    list_init(&head, sizeof(Node) * 2);
+    list_insert(&head, 1);
+    list_insert(&head, 2);
+    list_init(&head, sizeof(Node) * 4);
+    my_assert(head == NULL);
+    for (int i = 0; i < 4; i++)
+    {
+        list_insert(&head, (uint16_t)i);
+    }
+    my_assert(list_count_nodes(&head) == 4);
+    list_cleanup(&head);
+
+    // Stack heads in two calls are likely to share an address
+    list_leave_uncleaned(10);
+    list_reuse_head();
+
+    // A list that was never initialised gets no nodes
+    Node *bare = NULL;
+    list_insert(&bare, 5);
+    my_assert(bare == NULL);
+    printf_green("[PASS].\n");
+}
+
 // Main function to run all tests
 int main(int argc, char *argv[])
 {
@@ -502,6 +622,9 @@ int main(int argc, char *argv[])
         printf(" 12. test_list_delete_loop - Test multiple detelions\n");
         printf(" 13. test_list_search_loop - Test multiple search\n");
         printf(" 14. test_list_edge_cases - Test edge cases\n");
+        printf(" 15. test_list_independent_lists - Test that several lists can exist at once\n");
+        printf(" 16. test_list_many_lists - Test many lists and a copied head\n");
+        printf(" 17. test_list_reinit_without_cleanup - Test list_init on a head that was never cleaned up\n");
         printf(" 0. Run all tests\n");
         return 1;
     }
@@ -529,6 +652,9 @@ int main(int argc, char *argv[])
         test_list_delete_loop(1000);
         test_list_search_loop(1000);
         test_list_edge_cases();
+        test_list_independent_lists();
+        test_list_many_lists();
+        test_list_reinit_without_cleanup();
         break;
     case 1:
         test_list_init();
@@ -573,6 +699,15 @@ int main(int argc, char *argv[])
     case 14:
         test_list_edge_cases();
         break;
+    case 15:
+        test_list_independent_lists();
+        break;
+    case 16:
+        test_list_many_lists();
+        break;
+    case 17:
+        test_list_reinit_without_cleanup();
+        break;
 
     default:
         printf("Invalid test function\n");
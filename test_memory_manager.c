@@ -4,6 +4,9 @@
 #include <string.h>
 #include <stdlib.h>
 #include <time.h>
+#include <pthread.h>
+#include <sys/mman.h>
+#include <unistd.h>
 #include "common_defs.h"
 
 #include "gitdata.h"
@@ -83,6 +86,1326 @@ void test_random_blocks()
     printf_green("[PASS].\n");
 }
 
+void test_size_class_reuse()
+{
+    printf_yellow("  Testing size class reuse of freed blocks ---> ");
+    const int nBlocks = 20000;
+    mem_init(nBlocks * 48 + 4096);
+    void **blocks = malloc(nBlocks * sizeof(void *));
+    my_assert(blocks != NULL);
+
+    for (int k = 0; k < nBlocks; k++)
+    {
+        blocks[k] = mem_alloc(48);
+        my_assert(blocks[k] != NULL);
+    }
+    // Punch a hole in every other block, leaving only 4 KB at the tail
+    for (int k = 0; k < nBlocks; k += 2)
+    {
+        mem_free(blocks[k]);
+    }
+    // Same-sized requests must be served from the freed holes
+    char *first = blocks[0];
+    char *last = blocks[nBlocks - 1];
+    for (int k = 0; k < nBlocks; k += 2)
+    {
+        char *block = mem_alloc(40 + k % 9);
+        my_assert(block != NULL);
+        my_assert(block >= first && block < last);
+        blocks[k] = block;
+    }
+    for (int k = 0; k < nBlocks; k++)
+    {
+        mem_free(blocks[k]);
+    }
+
+    free(blocks);
+    mem_deinit();
+    printf_green("[PASS].\n");
+}
+
+void test_free_lookup()
+{
+    printf_yellow("  Testing mem_free lookup of many blocks ---> ");
+    const int nBlocks = 50000;
+    mem_init(nBlocks * 16);
+    void **blocks = malloc(nBlocks * sizeof(void *));
+    my_assert(blocks != NULL);
+
+    for (int k = 0; k < nBlocks; k++)
+    {
+        blocks[k] = mem_alloc(16);
+        my_assert(blocks[k] != NULL);
+    }
+    // Resizing within the block keeps it in place
+    my_assert(mem_resize(blocks[nBlocks / 2], 8) == blocks[nBlocks / 2]);
+
+    // Pointers that do not start a live block are rejected
+    mem_free((char *)blocks[1] + 4);
+    my_assert(mem_resize((char *)blocks[1] + 4, 32) == NULL);
+
+    // Free from the back so every block merges with its free successor
+    for (int k = nBlocks - 1; k >= 0; k--)
+    {
+        mem_free(blocks[k]);
+    }
+    mem_free(blocks[0]); // Double free is reported, not applied
+
+    void *whole = mem_alloc(nBlocks * 16);
+    my_assert(whole == blocks[0]);
+
+    mem_free(whole);
+    free(blocks);
+    mem_deinit();
+    printf_green("[PASS].\n");
+}
+
+void test_random_coalescing()
+{
+    printf_yellow("  Testing coalescing under random churn ---> ");
+    const int nSlots = 2000;
+    const int memSize = nSlots * 512;
+    mem_init(memSize);
+    void *slots[nSlots];
+    memset(slots, 0, sizeof(slots));
+
+    // Random mix of allocations and frees, in no particular address order
+    for (int k = 0; k < 200000; k++)
+    {
+        int slot = rand() % nSlots;
+        if (slots[slot] == NULL)
+        {
+            slots[slot] = mem_alloc(1 + rand() % 500);
+        }
+        else
+        {
+            mem_free(slots[slot]);
+            slots[slot] = NULL;
+        }
+        double fragmentation = mem_fragmentation();
+        my_assert(fragmentation >= 0.0 && fragmentation <= 1.0);
+    }
+#ifdef DEBUG
+    printf_yellow("  Fragmentation before release; %.3f\n", mem_fragmentation());
+#endif
+
+    // Once everything is released the pool must be one free block again
+    for (int k = 0; k < nSlots; k++)
+    {
+        if (slots[k] != NULL)
+        {
+            mem_free(slots[k]);
+        }
+    }
+    mem_flush_cache();
+    my_assert(mem_fragmentation() == 0.0);
+    void *whole = mem_alloc(memSize);
+    my_assert(whole != NULL);
+
+    mem_free(whole);
+    mem_deinit();
+    printf_green("[PASS].\n");
+}
+
+void test_descriptor_growth()
+{
+    printf_yellow("  Testing more blocks than MAX_BLOCKS ---> ");
+    const int nBlocks = MAX_BLOCKS + MAX_BLOCKS / 2;
+    // Every block gets its own descriptor when small blocks bypass the spans
+    MemOptions options = {.no_small_spans = true};
+    mem_init_with_options(nBlocks * MEM_ALIGNMENT, &options);
+    void **blocks = malloc(nBlocks * sizeof(void *));
+    my_assert(blocks != NULL);
+
+    for (int k = 0; k < nBlocks; k++)
+    {
+        blocks[k] = mem_alloc(8);
+        my_assert(blocks[k] != NULL);
+    }
+    // Recycle descriptors through merges and splits
+    for (int k = 0; k < nBlocks; k += 2)
+    {
+        mem_free(blocks[k]);
+    }
+    for (int k = 0; k < nBlocks; k += 2)
+    {
+        blocks[k] = mem_alloc(8);
+        my_assert(blocks[k] != NULL);
+    }
+    for (int k = 0; k < nBlocks; k++)
+    {
+        mem_free(blocks[k]);
+    }
+    void *whole = mem_alloc(nBlocks * MEM_ALIGNMENT);
+    my_assert(whole != NULL);
+
+    mem_free(whole);
+    free(blocks);
+    mem_deinit();
+    printf_green("[PASS].\n");
+}
+
+#define THREAD_COUNT 4
+#define THREAD_BLOCKS 2000
+#define THREAD_ROUNDS 20
+
+static void *thread_blocks[THREAD_COUNT][THREAD_BLOCKS];
+static pthread_barrier_t thread_barrier;
+
+static void *thread_worker(void *arg)
+{
+    int id = (int)(intptr_t)arg;
+    unsigned int seed = id + 1;
+
+    for (int round = 0; round < THREAD_ROUNDS; round++)
+    {
+        // Allocate a batch of mixed sizes and tag every block with the owner
+        for (int k = 0; k < THREAD_BLOCKS; k++)
+        {
+            unsigned char *block = mem_alloc(1 + rand_r(&seed) % 512);
+            my_assert(block != NULL);
+            block[0] = (unsigned char)id;
+            thread_blocks[id][k] = block;
+        }
+        pthread_barrier_wait(&thread_barrier);
+
+        // Free the neighbour's batch, so every free comes from another thread
+        int partner = (id + 1) % THREAD_COUNT;
+        for (int k = 0; k < THREAD_BLOCKS; k++)
+        {
+            my_assert(((unsigned char *)thread_blocks[partner][k])[0] == partner);
+            mem_free(thread_blocks[partner][k]);
+        }
+        pthread_barrier_wait(&thread_barrier);
+    }
+    return NULL;
+}
+
+void test_threaded_alloc_free()
+{
+    printf_yellow("  Testing concurrent alloc and cross-thread free ---> ");
+    const int memSize = 16 * 1024 * 1024;
+    mem_init(memSize);
+    pthread_barrier_init(&thread_barrier, NULL, THREAD_COUNT);
+
+    pthread_t threads[THREAD_COUNT];
+    for (int t = 0; t < THREAD_COUNT; t++)
+    {
+        my_assert(pthread_create(&threads[t], NULL, thread_worker, (void *)(intptr_t)t) == 0);
+    }
+    for (int t = 0; t < THREAD_COUNT; t++)
+    {
+        pthread_join(threads[t], NULL);
+    }
+    pthread_barrier_destroy(&thread_barrier);
+
+    // Exited threads hand their memory back, so the whole pool is free again
+    mem_flush_cache();
+    void *whole = mem_alloc(memSize);
+    my_assert(whole != NULL);
+
+    mem_free(whole);
+    mem_deinit();
+    printf_green("[PASS].\n");
+}
+
+void test_arena_isolation()
+{
+    printf_yellow("  Testing independent arenas ---> ");
+    mem_init(1024);
+    MemArena *first = mem_arena_create(1024);
+    MemArena *second = mem_arena_create(1024);
+    my_assert(first != NULL && second != NULL);
+
+    // Every pool can be filled on its own without touching the others
+    void *a = mem_arena_alloc(first, 1024);
+    void *b = mem_arena_alloc(second, 1024);
+    void *c = mem_alloc(1024);
+    my_assert(a != NULL && b != NULL && c != NULL);
+    my_assert(mem_arena_alloc(first, 1) == NULL);
+    my_assert(mem_arena_of(a) == first);
+    my_assert(mem_arena_of(b) == second);
+
+    // Destroying an arena releases its blocks and leaves the rest intact
+    memset(c, 0xAB, 1024);
+    mem_arena_destroy(first);
+    my_assert(mem_arena_of(a) == NULL);
+    my_assert(((unsigned char *)c)[1023] == 0xAB);
+    mem_arena_free(second, b);
+    my_assert(mem_arena_alloc(second, 1024) == b);
+
+    // A second mem_init replaces the default pool instead of leaking it
+    mem_init(2048);
+    my_assert(mem_alloc(2048) != NULL);
+
+    mem_arena_destroy(second);
+    mem_deinit();
+    printf_green("[PASS].\n");
+}
+
+void test_aligned_alloc()
+{
+    printf_yellow("  Testing default and explicit alignment ---> ");
+    const int memSize = 64 * 1024;
+    mem_init(memSize);
+
+    // Odd sizes are rounded so that the next block is aligned as well
+    void *odd[8];
+    for (int i = 0; i < 8; i++)
+    {
+        odd[i] = mem_alloc(1 + i * 37);
+        my_assert(odd[i] != NULL);
+        my_assert((uintptr_t)odd[i] % MEM_ALIGNMENT == 0);
+    }
+
+    void *line = mem_alloc_aligned(100, 64);
+    void *page = mem_alloc_aligned(5000, 4096);
+    my_assert(line != NULL && (uintptr_t)line % 64 == 0);
+    my_assert(page != NULL && (uintptr_t)page % 4096 == 0);
+    my_assert(mem_alloc_aligned(100, 48) == NULL);
+
+    // The padding in front of aligned blocks is given back on free
+    for (int i = 0; i < 8; i++)
+    {
+        mem_free(odd[i]);
+    }
+    mem_free(line);
+    mem_free(page);
+    mem_flush_cache();
+    my_assert(mem_fragmentation() == 0.0);
+    void *whole = mem_alloc(memSize);
+    my_assert(whole != NULL);
+
+    mem_free(whole);
+    mem_deinit();
+    printf_green("[PASS].\n");
+}
+
+void test_mmap_backing()
+{
+    printf_yellow("  Testing mmap and huge page backed pools ---> ");
+    const int memSize = 4 * 1024 * 1024 + 100;
+    MemOptions options = {MEM_BACKING_MMAP};
+    mem_init_with_options(memSize, &options);
+    my_assert(mem_arena_backing(NULL) == MEM_BACKING_MMAP);
+
+    // The whole pool is usable and page aligned
+    char *whole = mem_alloc(memSize);
+    my_assert(whole != NULL && (uintptr_t)whole % 4096 == 0);
+    memset(whole, 1, memSize);
+    mem_free(whole);
+
+    // Huge pages fall back to normal pages when the system has none to give
+    options.backing = MEM_BACKING_HUGE_PAGES;
+    MemArena *arena = mem_arena_create_with_options(memSize, &options);
+    my_assert(arena != NULL);
+    my_assert(mem_arena_backing(arena) != MEM_BACKING_MALLOC);
+    whole = mem_arena_alloc(arena, memSize);
+    my_assert(whole != NULL);
+    memset(whole, 2, memSize);
+    mem_arena_destroy(arena);
+
+    mem_deinit();
+    printf_green("[PASS].\n");
+}
+
+// Counts how many pages of [start, start + size) are resident
+static size_t resident_pages(void *start, size_t size)
+{
+    size_t page = (size_t)sysconf(_SC_PAGESIZE);
+    uintptr_t first = ((uintptr_t)start + page - 1) & ~(page - 1);
+    uintptr_t last = ((uintptr_t)start + size) & ~(page - 1);
+    size_t pages = (last - first) / page;
+    unsigned char *vec = malloc(pages);
+    size_t resident = 0;
+    if (mincore((void *)first, last - first, vec) == 0)
+    {
+        for (size_t i = 0; i < pages; i++)
+        {
+            resident += vec[i] & 1;
+        }
+    }
+    free(vec);
+    return resident;
+}
+
+void test_trim()
+{
+    printf_yellow("  Testing returning free pages to the OS ---> ");
+    const int memSize = 8 * 1024 * 1024;
+    const int blockSize = 4 * 1024 * 1024;
+
+    // Explicit trim releases the pages of freed blocks
+    MemOptions options = {MEM_BACKING_MMAP};
+    mem_init_with_options(memSize, &options);
+    char *block = mem_alloc(blockSize);
+    memset(block, 1, blockSize);
+    my_assert(resident_pages(block, blockSize) > 0);
+    mem_free(block);
+    my_assert(mem_trim() >= (size_t)blockSize);
+    my_assert(resident_pages(block, blockSize) == 0);
+
+    // The memory is usable again after a trim
+    block = mem_alloc(blockSize);
+    my_assert(block != NULL && block[0] == 0);
+    memset(block, 2, blockSize);
+    mem_free(block);
+
+    // With a threshold and no decay, large blocks are released as soon as they are freed
+    options.trim_threshold = 1024 * 1024;
+    MemArena *arena = mem_arena_create_with_options(memSize, &options);
+    char *large = mem_arena_alloc(arena, blockSize);
+    char *small = mem_arena_alloc(arena, 64 * 1024);
+    char *guard = mem_arena_alloc(arena, 64 * 1024);
+    memset(large, 3, blockSize);
+    memset(small, 3, 64 * 1024);
+    mem_arena_free(arena, small);
+    my_assert(resident_pages(small, 64 * 1024) > 0);
+    mem_arena_free(arena, large);
+    my_assert(resident_pages(large, blockSize) == 0);
+    mem_arena_free(arena, guard);
+    mem_arena_destroy(arena);
+
+    mem_deinit();
+    printf_green("[PASS].\n");
+}
+
+void test_pool_growth()
+{
+    printf_yellow("  Testing pool growth up to a ceiling ---> ");
+    const int memSize = 64 * 1024;
+    const int maxSize = 1024 * 1024;
+    MemOptions options = {0};
+    options.max_size = maxSize;
+    mem_init_with_options(memSize, &options);
+
+    // Allocations beyond the initial pool succeed until the ceiling is reached
+    void *blocks[64];
+    int count = 0;
+    size_t total = 0;
+    while (count < 64)
+    {
+        blocks[count] = mem_alloc(40 * 1024);
+        if (blocks[count] == NULL)
+        {
+            break;
+        }
+        memset(blocks[count], count, 40 * 1024);
+        total += 40 * 1024;
+        count++;
+    }
+    my_assert(total > (size_t)memSize);
+    my_assert(total <= (size_t)maxSize);
+    my_assert(((unsigned char *)blocks[count - 1])[0] == count - 1);
+
+    // Small objects are served from the grown regions as well
+    void *small = mem_alloc(32);
+    my_assert(small != NULL);
+    void *large = mem_alloc(maxSize);
+    my_assert(large == NULL);
+
+    // Freed blocks coalesce within each region, so the initial region is whole again
+    for (int i = 0; i < count; i++)
+    {
+        mem_free(blocks[i]);
+    }
+    mem_free(small);
+    mem_flush_cache();
+    void *whole = mem_alloc(memSize);
+    my_assert(whole != NULL);
+
+    mem_free(whole);
+    mem_deinit();
+    printf_green("[PASS].\n");
+}
+
+static void *stats_worker(void *arg)
+{
+    // Leaves five of ten small objects allocated when the thread exits
+    void **objects = (void **)arg;
+    for (int i = 0; i < 10; i++)
+    {
+        objects[i] = mem_alloc(32);
+    }
+    for (int i = 0; i < 5; i++)
+    {
+        mem_free(objects[i]);
+    }
+    return NULL;
+}
+
+void test_stats()
+{
+    printf_yellow("  Testing mem_get_stats ---> ");
+    const size_t memSize = 1024 * 1024;
+    mem_init(memSize);
+
+    // A fresh pool is one free block
+    MemStats stats = mem_get_stats();
+    my_assert(stats.pool_size == memSize);
+    my_assert(stats.bytes_in_use == 0);
+    my_assert(stats.bytes_free == memSize);
+    my_assert(stats.largest_free_block == memSize);
+    my_assert(stats.free_blocks == 1);
+    my_assert(stats.alloc_count == 0 && stats.free_count == 0 && stats.resize_count == 0);
+
+    // Blocks are counted at their rounded size, and a freed block is a free block of its own
+    void *a = mem_alloc(1000);
+    void *b = mem_alloc(1000);
+    void *c = mem_alloc(1000);
+    mem_free(b);
+    stats = mem_get_stats();
+    my_assert(stats.bytes_in_use == 2 * 1008);
+    my_assert(stats.bytes_free == memSize - 2 * 1008);
+    my_assert(stats.free_blocks == 2);
+    my_assert(stats.largest_free_block == memSize - 3 * 1008);
+    my_assert(stats.alloc_count == 3 && stats.free_count == 1);
+    my_assert(stats.max_search_length >= 1 && stats.avg_search_length >= 1.0);
+
+    // Shrinking returns the tail, which joins the free block after it
+    a = mem_resize(a, 500);
+    stats = mem_get_stats();
+    my_assert(stats.resize_count == 1);
+    my_assert(stats.bytes_in_use == 512 + 1008);
+    my_assert(stats.free_blocks == 2);
+
+    // A request that cannot be met is counted as failed
+    my_assert(mem_alloc(2 * memSize) == NULL);
+    stats = mem_get_stats();
+    my_assert(stats.alloc_count == 4 && stats.failed_allocs == 1);
+
+    // Small objects count at their size class, not as the whole span they come from
+    void *small = mem_alloc(32);
+    stats = mem_get_stats();
+    my_assert(stats.bytes_in_use == 512 + 1008 + 32);
+    mem_free(small);
+    stats = mem_get_stats();
+    my_assert(stats.bytes_in_use == 512 + 1008);
+    my_assert(stats.alloc_count == 5 && stats.free_count == 2);
+
+    // Another thread's calls are counted, also after the thread has exited
+    void *objects[10];
+    pthread_t thread;
+    my_assert(pthread_create(&thread, NULL, stats_worker, objects) == 0);
+    pthread_join(thread, NULL);
+    stats = mem_get_stats();
+    my_assert(stats.alloc_count == 15 && stats.free_count == 7);
+    my_assert(stats.bytes_in_use == 512 + 1008 + 5 * 32);
+    for (int i = 5; i < 10; i++)
+    {
+        mem_free(objects[i]);
+    }
+    stats = mem_get_stats();
+    my_assert(stats.bytes_in_use == 512 + 1008);
+
+    mem_free(a);
+    mem_free(c);
+    mem_deinit();
+    printf_green("[PASS].\n");
+}
+
+void test_object_pool()
+{
+    printf_yellow("  Testing fixed-size object pool ---> ");
+    const size_t arenaSize = 4096;
+    MemArena *arena = mem_arena_create(arenaSize);
+    my_assert(arena != NULL);
+    MemObjectPool *pool = mem_object_pool_create(arena, 24, 8);
+    my_assert(pool != NULL);
+
+    // Objects are packed back to back, and the pool fills the whole arena
+    void *objects[arenaSize / 24 + 1];
+    size_t count = 0;
+    while (count < arenaSize / 24 + 1 && (objects[count] = mem_object_pool_alloc(pool)) != NULL)
+    {
+        memset(objects[count], (int)count, 24);
+        count++;
+    }
+    my_assert(count == arenaSize / 24);
+    my_assert((char *)objects[1] - (char *)objects[0] == 24);
+    my_assert(((unsigned char *)objects[count - 1])[23] == (unsigned char)(count - 1));
+
+    // A freed object is handed out again by the next allocation
+    mem_object_pool_free(pool, objects[7]);
+    my_assert(mem_object_pool_alloc(pool) == objects[7]);
+    mem_object_pool_destroy(pool);
+
+    // Destroying the pool returns its slabs to the arena
+    void *whole = mem_arena_alloc(arena, arenaSize);
+    my_assert(whole != NULL);
+    mem_arena_free(arena, whole);
+
+    // Objects honour the requested alignment
+    pool = mem_object_pool_create(arena, 40, 64);
+    my_assert(pool != NULL);
+    void *first = mem_object_pool_alloc(pool);
+    void *second = mem_object_pool_alloc(pool);
+    my_assert((uintptr_t)first % 64 == 0 && (uintptr_t)second % 64 == 0);
+    my_assert((char *)second - (char *)first == 64);
+    mem_object_pool_destroy(pool);
+
+    my_assert(mem_object_pool_create(arena, 16, 24) == NULL);
+    mem_arena_destroy(arena);
+    printf_green("[PASS].\n");
+}
+
+void test_batch()
+{
+    printf_yellow("  Testing batch allocation and free ---> ");
+    const size_t memSize = 32 * 1024;
+    mem_init(memSize);
+
+    // A batch is carved from one free block, so the blocks are contiguous
+    void *blocks[1000];
+    my_assert(mem_alloc_batch(100, 100, blocks) == 100);
+    for (int i = 0; i < 100; i++)
+    {
+        my_assert(blocks[i] != NULL);
+        memset(blocks[i], i, 100);
+        if (i > 0)
+        {
+            my_assert((char *)blocks[i] - (char *)blocks[i - 1] == 112);
+        }
+    }
+    my_assert(((unsigned char *)blocks[99])[99] == 99);
+
+    // Freeing in any order coalesces everything back into one block
+    void *shuffled[100];
+    for (int i = 0; i < 100; i++)
+    {
+        shuffled[i] = blocks[(i * 37) % 100];
+    }
+    mem_free_batch(shuffled, 100);
+    MemStats stats = mem_get_stats();
+    my_assert(stats.free_blocks == 1);
+    my_assert(stats.largest_free_block == memSize);
+    my_assert(stats.free_count == 100);
+
+    // A batch that does not fit returns what it could allocate and NULL for the rest
+    size_t allocated = mem_alloc_batch(1000, 100, blocks);
+    my_assert(allocated == memSize / 112);
+    my_assert(blocks[allocated - 1] != NULL && blocks[allocated] == NULL);
+    mem_free_batch(blocks, 1000);
+    stats = mem_get_stats();
+    my_assert(stats.free_blocks == 1 && stats.bytes_in_use == 0);
+    mem_deinit();
+
+    // Small blocks come from the thread cache and can be freed together with large ones
+    mem_init(1024 * 1024);
+    my_assert(mem_alloc_batch(50, 32, blocks) == 50);
+    my_assert(mem_alloc_batch(10, 4000, blocks + 50) == 10);
+    for (int i = 0; i < 60; i++)
+    {
+        my_assert(blocks[i] != NULL);
+        memset(blocks[i], 0xAB, i < 50 ? 32 : 4000);
+    }
+    mem_free_batch(blocks, 60);
+    stats = mem_get_stats();
+    my_assert(stats.bytes_in_use == 0);
+    mem_deinit();
+    printf_green("[PASS].\n");
+}
+
+void test_reset_and_mark()
+{
+    printf_yellow("  Testing mem_reset and mem_mark/mem_release ---> ");
+    const size_t memSize = 1024 * 1024;
+    mem_init(memSize);
+
+    // A reset drops every block, large and small, at once
+    for (int i = 0; i < 100; i++)
+    {
+        my_assert(mem_alloc(i % 2 == 0 ? 32 : 1000) != NULL);
+    }
+    mem_reset();
+    MemStats stats = mem_get_stats();
+    my_assert(stats.bytes_in_use == 0);
+    my_assert(stats.free_blocks == 1 && stats.largest_free_block == memSize);
+    void *whole = mem_alloc(memSize);
+    my_assert(whole != NULL);
+    mem_free(whole);
+
+    // Blocks allocated before a mark survive its release
+    void *kept = mem_alloc(1000);
+    memset(kept, 0x5A, 1000);
+    MemMark outer = mem_mark();
+    my_assert(outer != MEM_MARK_INVALID);
+    my_assert(mem_alloc(2000) != NULL);
+    my_assert(mem_alloc(32) != NULL);
+    void *freed = mem_alloc(500);
+    mem_free(freed);
+    void *batch[10];
+    my_assert(mem_alloc_batch(10, 64, batch) == 10);
+
+    // Releasing an inner mark drops only what came after it
+    MemMark inner = mem_mark();
+    my_assert(mem_alloc(3000) != NULL);
+    mem_release(inner);
+    stats = mem_get_stats();
+    my_assert(stats.bytes_in_use == 1008 + 2000 + 32 + 10 * 64);
+
+    // Releasing the outer mark leaves only the block from before it
+    mem_release(outer);
+    stats = mem_get_stats();
+    my_assert(stats.bytes_in_use == 1008);
+    my_assert(((unsigned char *)kept)[999] == 0x5A);
+    mem_release(outer); // Already closed
+    mem_free(kept);
+    stats = mem_get_stats();
+    my_assert(stats.free_blocks == 1);
+
+    mem_deinit();
+    printf_green("[PASS].\n");
+}
+
+#define SPAN_STACK_THREADS 4
+#define SPAN_STACK_ROUNDS 200
+
+static void *span_stack_worker(void *arg)
+{
+    // Fills and empties several spans per round, so empty spans keep moving between
+    // the threads through the shared stacks
+    long failures = 0;
+    unsigned char tag = (unsigned char)(uintptr_t)arg;
+    void *objects[600];
+    for (int round = 0; round < SPAN_STACK_ROUNDS; round++)
+    {
+        for (int i = 0; i < 600; i++)
+        {
+            objects[i] = mem_alloc(16);
+            if (objects[i] == NULL)
+            {
+                failures++;
+                continue;
+            }
+            memset(objects[i], tag, 16);
+        }
+        for (int i = 0; i < 600; i++)
+        {
+            if (objects[i] == NULL)
+            {
+                continue;
+            }
+            unsigned char *bytes = (unsigned char *)objects[i];
+            if (bytes[0] != tag || bytes[15] != tag)
+            {
+                failures++; // Another thread was handed the same object
+            }
+            mem_free(objects[i]);
+        }
+    }
+    return (void *)failures;
+}
+
+void test_span_stacks()
+{
+    printf_yellow("  Testing lock-free sharing of empty spans ---> ");
+    const size_t memSize = 1024 * 1024;
+    mem_init(memSize);
+
+    pthread_t threads[SPAN_STACK_THREADS];
+    for (int i = 0; i < SPAN_STACK_THREADS; i++)
+    {
+        my_assert(pthread_create(&threads[i], NULL, span_stack_worker, (void *)(uintptr_t)(i + 1)) == 0);
+    }
+    for (int i = 0; i < SPAN_STACK_THREADS; i++)
+    {
+        void *failures;
+        pthread_join(threads[i], &failures);
+        my_assert(failures == NULL);
+    }
+
+    // Every object was freed by its owner, so nothing is in use and the pool is whole
+    // again once the shared stacks are flushed
+    MemStats stats = mem_get_stats();
+    my_assert(stats.bytes_in_use == 0);
+    mem_flush_cache();
+    my_assert(mem_fragmentation() == 0.0);
+
+    // Spans released by the threads can be reused by this one, then the pool can hand
+    // out one block over all of it
+    void *small = mem_alloc(16);
+    my_assert(small != NULL);
+    mem_free(small);
+    mem_flush_cache();
+    void *whole = mem_alloc(memSize);
+    my_assert(whole != NULL);
+    mem_free(whole);
+
+    mem_deinit();
+    printf_green("[PASS].\n");
+}
+
+#define REMOTE_OBJECTS 3000
+#define REMOTE_THREADS 3
+
+typedef struct RemoteShare
+{
+    void **objects;
+    size_t first;
+    size_t count;
+} RemoteShare;
+
+static void *remote_free_worker(void *arg)
+{
+    RemoteShare *share = (RemoteShare *)arg;
+    for (size_t i = share->first; i < share->first + share->count; i++)
+    {
+        mem_free(share->objects[i]);
+    }
+    return NULL;
+}
+
+typedef struct RemoteOwner
+{
+    void **objects;
+    int stage; // 1 once the objects exist, 2 once the owner may exit
+} RemoteOwner;
+
+static void *remote_owner_worker(void *arg)
+{
+    RemoteOwner *owner = (RemoteOwner *)arg;
+    for (int i = 0; i < 200; i++)
+    {
+        owner->objects[i] = mem_alloc(48);
+    }
+    __atomic_store_n(&owner->stage, 1, __ATOMIC_RELEASE);
+    while (__atomic_load_n(&owner->stage, __ATOMIC_ACQUIRE) != 2)
+    {
+        sched_yield();
+    }
+    return NULL;
+}
+
+void test_remote_free()
+{
+    printf_yellow("  Testing remote-free queues ---> ");
+    const size_t memSize = 1024 * 1024;
+    mem_init(memSize);
+
+    // Objects freed by other threads wait in this thread's queue until it drains it
+    static void *objects[REMOTE_OBJECTS];
+    for (size_t i = 0; i < REMOTE_OBJECTS; i++)
+    {
+        objects[i] = mem_alloc(48);
+        my_assert(objects[i] != NULL);
+    }
+    pthread_t threads[REMOTE_THREADS];
+    RemoteShare shares[REMOTE_THREADS];
+    for (int t = 0; t < REMOTE_THREADS; t++)
+    {
+        shares[t].objects = objects;
+        shares[t].first = (size_t)t * (REMOTE_OBJECTS / REMOTE_THREADS);
+        shares[t].count = REMOTE_OBJECTS / REMOTE_THREADS;
+        my_assert(pthread_create(&threads[t], NULL, remote_free_worker, &shares[t]) == 0);
+    }
+    for (int t = 0; t < REMOTE_THREADS; t++)
+    {
+        pthread_join(threads[t], NULL);
+    }
+    my_assert(mem_get_stats().bytes_in_use == REMOTE_OBJECTS * 48);
+
+    // The owner drains the whole queue in one batch when it runs out of objects or flushes
+    mem_flush_cache();
+    my_assert(mem_get_stats().bytes_in_use == 0);
+    my_assert(mem_fragmentation() == 0.0);
+
+    // An owner that exits with objects in its queue hands them back, and later frees of
+    // its objects go to the pool under the lock
+    for (int round = 0; round < 2; round++)
+    {
+        static void *owned[200];
+        RemoteOwner owner = {owned, 0};
+        pthread_t thread;
+        my_assert(pthread_create(&thread, NULL, remote_owner_worker, &owner) == 0);
+        while (__atomic_load_n(&owner.stage, __ATOMIC_ACQUIRE) != 1)
+        {
+            sched_yield();
+        }
+        for (int i = 0; i < 100; i++)
+        {
+            mem_free(owned[i]);
+        }
+        __atomic_store_n(&owner.stage, 2, __ATOMIC_RELEASE);
+        pthread_join(thread, NULL);
+        my_assert(mem_get_stats().bytes_in_use == 100 * 48);
+        for (int i = 100; i < 200; i++)
+        {
+            mem_free(owned[i]);
+        }
+        my_assert(mem_get_stats().bytes_in_use == 0);
+    }
+
+    mem_flush_cache();
+    my_assert(mem_fragmentation() == 0.0);
+    mem_deinit();
+    printf_green("[PASS].\n");
+}
+
+void test_handles_and_compaction()
+{
+    printf_yellow("  Testing relocatable handles and compaction ---> ");
+    const size_t memSize = 64 * 1024;
+    mem_init(memSize);
+
+    // Thirty handles with a recognisable pattern each
+    MemHandle *handles[30];
+    for (int i = 0; i < 30; i++)
+    {
+        handles[i] = mem_handle_alloc(2048);
+        my_assert(handles[i] != NULL);
+        char *data = (char *)mem_handle_lock(handles[i]);
+        memset(data, 'a' + i % 26, 2048);
+        mem_handle_unlock(handles[i]);
+    }
+
+    // Handle blocks are only reachable through their handles
+    void *raw = mem_handle_lock(handles[0]);
+    mem_handle_unlock(handles[0]);
+    my_assert(mem_resize(raw, 4096) == NULL);
+
+    // Freeing every other handle leaves the free space in 2 KB holes
+    for (int i = 1; i < 30; i += 2)
+    {
+        mem_handle_free(handles[i]);
+        handles[i] = NULL;
+    }
+    my_assert(mem_alloc(20000) == NULL);
+
+    // A locked handle stays put while the others slide together around it. With no
+    // budget every call moves a block and stops, so the pass takes many calls.
+    void *pinned = mem_handle_lock(handles[10]);
+    int calls = 1;
+    while (!mem_compact(0))
+    {
+        calls++;
+    }
+    my_assert(calls > 1);
+    my_assert(mem_handle_lock(handles[10]) == pinned);
+    mem_handle_unlock(handles[10]);
+    mem_handle_unlock(handles[10]);
+
+    for (int i = 0; i < 30; i += 2)
+    {
+        char *data = (char *)mem_handle_lock(handles[i]);
+        my_assert(data[0] == 'a' + i % 26 && data[2047] == 'a' + i % 26);
+        mem_handle_unlock(handles[i]);
+    }
+
+    // Free space is contiguous again after the pinned block, so the large request fits
+    void *large = mem_alloc(20000);
+    my_assert(large != NULL);
+    mem_free(large);
+
+    // A second pass has nothing left to move
+    my_assert(mem_compact(1000));
+    for (int i = 0; i < 30; i += 2)
+    {
+        mem_handle_free(handles[i]);
+    }
+    my_assert(mem_fragmentation() == 0.0);
+    my_assert(mem_get_stats().bytes_in_use == 0);
+
+    // mem_reset drops every handle together with its block
+    my_assert(mem_handle_alloc(1024) != NULL);
+    mem_reset();
+    my_assert(mem_get_stats().bytes_in_use == 0);
+
+    // Handles count every attempt once and a failure on top, like mem_alloc
+    MemStats before = mem_get_stats();
+    my_assert(mem_handle_alloc(1024) != NULL);
+    my_assert(mem_handle_alloc((size_t)1 << 30) == NULL);
+    MemStats after = mem_get_stats();
+    my_assert(after.alloc_count == before.alloc_count + 2);
+    my_assert(after.failed_allocs == before.failed_allocs + 1);
+    my_assert(after.failed_allocs <= after.alloc_count);
+
+    mem_deinit();
+    printf_green("[PASS].\n");
+}
+
+void test_placement_policies()
+{
+    printf_yellow("  Testing next-fit and best-fit placement ---> ");
+    const size_t memSize = 32 * 1024;
+    MemOptions options = {0};
+
+    // Next-fit continues after the last allocation instead of reusing the first hole,
+    // and wraps around to the start once the end of the pool is used up
+    options.placement = MEM_PLACEMENT_NEXT_FIT;
+    mem_init_with_options(memSize, &options);
+    char *a = mem_alloc(4096);
+    char *b = mem_alloc(4096);
+    char *c = mem_alloc(4096);
+    char *d = mem_alloc(4096);
+    my_assert(a != NULL && b != NULL && c != NULL && d != NULL);
+    mem_free(a);
+    mem_free(c);
+    char *x = mem_alloc(1024);
+    my_assert(x == d + 4096);
+    char *rest = mem_alloc(memSize - 4 * 4096 - 1024);
+    my_assert(rest == x + 1024);
+    char *wrapped = mem_alloc(2000);
+    my_assert(wrapped == a);
+    mem_deinit();
+
+    // Best-fit takes the smallest hole that fits, wherever it is
+    options.placement = MEM_PLACEMENT_BEST_FIT;
+    mem_init_with_options(memSize, &options);
+    // Fences above the small object limit, so that they are pool blocks between the holes
+    char *large = mem_alloc(3008);
+    char *fence1 = mem_alloc(272);
+    char *small = mem_alloc(1008);
+    char *fence2 = mem_alloc(272);
+    char *medium = mem_alloc(2000);
+    char *fence3 = mem_alloc(272);
+    my_assert(large != NULL && fence1 != NULL && small != NULL && fence2 != NULL && medium != NULL && fence3 != NULL);
+    mem_free(large);
+    mem_free(small);
+    mem_free(medium);
+    my_assert(mem_alloc(900) == small);
+    my_assert(mem_alloc(1900) == medium);
+    my_assert(mem_alloc(2900) == large);
+
+    // The size tree follows merges, so the whole pool is one block again once all is freed
+    char *blocks[] = {small, medium, large, fence1, fence2, fence3};
+    for (int i = 0; i < 6; i++)
+    {
+        mem_free(blocks[i]);
+    }
+    my_assert(mem_alloc(memSize) != NULL);
+    mem_deinit();
+    printf_green("[PASS].\n");
+}
+
+void test_tlsf_placement()
+{
+    printf_yellow("  Testing TLSF placement ---> ");
+    const size_t memSize = 8192;
+    MemOptions options = {0};
+    options.placement = MEM_PLACEMENT_TLSF;
+    mem_init_with_options(memSize, &options);
+    char *small = mem_alloc(1040);
+    char *fence1 = mem_alloc(16);
+    char *large = mem_alloc(1504);
+    char *fence2 = mem_alloc(16);
+    char *rest = mem_alloc(memSize - 1040 - 16 - 1504 - 16);
+    my_assert(small != NULL && fence1 != NULL && large != NULL && fence2 != NULL && rest != NULL);
+    mem_free(small);
+    mem_free(large);
+
+    // The request is rounded up to the next finer class, so the 1040-byte hole in the
+    // class of the request is passed over for one that is sure to fit
+    char *first = mem_alloc(1030);
+    my_assert(first == large);
+
+    // With nothing in a higher class, the head of the request's own class is tried
+    char *second = mem_alloc(1040);
+    my_assert(second == small);
+
+    // Neither search walks a free list
+    MemStats stats = mem_get_stats();
+    my_assert(stats.max_search_length <= 2);
+
+    // Blocks still merge into the whole pool once everything is freed
+    char *blocks[] = {first, second, fence1, fence2, rest};
+    for (int i = 0; i < 5; i++)
+    {
+        mem_free(blocks[i]);
+    }
+    my_assert(mem_alloc(memSize) != NULL);
+    mem_deinit();
+    printf_green("[PASS].\n");
+}
+
+void test_buddy_placement()
+{
+    printf_yellow("  Testing buddy placement ---> ");
+    const size_t memSize = 64 * 1024;
+    MemOptions options = {0};
+    options.placement = MEM_PLACEMENT_BUDDY;
+    mem_init_with_options(memSize, &options);
+
+    // Blocks are rounded up to a power of two, and a split leaves the upper half free
+    char *a = mem_alloc(3000);
+    char *b = mem_alloc(4096);
+    char *c = mem_alloc(1000);
+    my_assert(a != NULL && b == a + 4096 && c == a + 8192);
+    MemStats stats = mem_get_stats();
+    my_assert(stats.buddy_slack == (4096 - 3008) + (1024 - 1008));
+    my_assert(stats.internal_fragmentation > 0.0 && stats.internal_fragmentation < 0.25);
+
+    // Freeing both halves merges them, so a block of twice the size fits where they were
+    mem_free(a);
+    mem_free(b);
+    char *d = mem_alloc(8000);
+    my_assert(d == a);
+
+    // Once everything is freed the buddies merge back into the whole pool
+    mem_free(c);
+    mem_free(d);
+    stats = mem_get_stats();
+    my_assert(stats.free_blocks == 1 && stats.largest_free_block == memSize);
+    my_assert(stats.buddy_slack == 0);
+    mem_deinit();
+
+    // A pool that is not a power of two is split into powers of two, largest first
+    mem_init_with_options(48 * 1024, &options);
+    stats = mem_get_stats();
+    my_assert(stats.free_blocks == 2 && stats.largest_free_block == 32 * 1024);
+    mem_deinit();
+    printf_green("[PASS].\n");
+}
+
+void test_free_block_scan()
+{
+    printf_yellow("  Testing free block scan past many small blocks ---> ");
+    const int nHoles = 100;
+    const size_t memSize = 2032 + 272 + nHoles * (1040 + 272);
+    mem_init(memSize);
+    char *target = mem_alloc(2032);
+    char *fences[101];
+    fences[0] = mem_alloc(272);
+    char *holes[100];
+    for (int i = 0; i < nHoles; i++)
+    {
+        holes[i] = mem_alloc(1040);
+        fences[i + 1] = mem_alloc(272);
+        my_assert(holes[i] != NULL && fences[i + 1] != NULL);
+    }
+    my_assert(target != NULL && fences[0] != NULL);
+
+    // The only block that fits is the oldest in its size class, behind every small hole
+    mem_free(target);
+    for (int i = 0; i < nHoles; i++)
+    {
+        mem_free(holes[i]);
+    }
+    char *found = mem_alloc(1500);
+    my_assert(found == target);
+    my_assert(mem_get_stats().max_search_length >= (size_t)nHoles);
+
+    // Taking blocks out of the middle of the class keeps the rest findable
+    for (int i = 0; i < nHoles; i += 2)
+    {
+        my_assert(mem_alloc(1040) != NULL);
+    }
+    my_assert(mem_get_stats().free_blocks == (size_t)nHoles / 2 + 1);
+
+    mem_deinit();
+    printf_green("[PASS].\n");
+}
+
+void test_granule_spans()
+{
+    printf_yellow("  Testing small allocations from granule spans ---> ");
+    const size_t memSize = 32 * 1024; // Large enough for granule spans, too small for thread caches
+    mem_init(memSize);
+
+    // Node-sized objects sit back to back, with no block header or descriptor between them
+    char *nodes[100];
+    for (int i = 0; i < 100; i++)
+    {
+        nodes[i] = mem_alloc(16);
+        my_assert(nodes[i] != NULL && ((uintptr_t)nodes[i] % MEM_ALIGNMENT) == 0);
+        my_assert(i == 0 || nodes[i] == nodes[i - 1] + 16);
+    }
+    my_assert(mem_get_stats().bytes_in_use == 100 * 16);
+
+    // A freed run of granules is found again by a request that fits it, across word boundaries
+    for (int i = 60; i < 70; i++)
+    {
+        mem_free(nodes[i]);
+    }
+    char *run = mem_alloc(160);
+    my_assert(run == nodes[60]);
+    mem_free(nodes[10]);
+    mem_free(nodes[11]);
+    char *wide = mem_alloc(40);
+    my_assert(wide != nodes[10] && wide != NULL);
+    char *narrow = mem_alloc(32);
+    my_assert(narrow == nodes[10]);
+
+    // Only the start of an object can be freed, and only once
+    mem_free(run + 16);
+    mem_free(nodes[20]);
+    mem_free(nodes[20]);
+    my_assert(mem_get_stats().bytes_in_use == 100 * 16 - 16 + 48);
+
+    // Resizing keeps an object in place while its granules hold it, and moves it otherwise
+    strcpy(wide, "granule");
+    my_assert(mem_resize(wide, 48) == wide);
+    char *moved = mem_resize(wide, 200);
+    my_assert(moved != NULL && strcmp(moved, "granule") == 0);
+
+    // Once every object is freed, the granule span goes back and the pool is whole again
+    mem_free(run);
+    mem_free(narrow);
+    mem_free(moved);
+    for (int i = 0; i < 100; i++)
+    {
+        if ((i < 60 || i >= 70) && i != 10 && i != 11 && i != 20)
+        {
+            mem_free(nodes[i]);
+        }
+    }
+    my_assert(mem_get_stats().bytes_in_use == 0);
+    my_assert(mem_alloc(memSize) != NULL);
+    mem_deinit();
+    printf_green("[PASS].\n");
+}
+
+void test_zero_size_free()
+{
+    printf_yellow("  Testing mem_free of a zero-size result beside a live block ---> ");
+    mem_init(1024);
+
+    // Freeing the result of a zero-size allocation must leave every live block alone
+    char *zero = mem_alloc(0);
+    char *live = mem_alloc(64);
+    my_assert(live != NULL);
+    memset(live, 'q', 64);
+    mem_free(zero);
+    char *other = mem_alloc(64);
+    my_assert(other != NULL && other != live);
+    memset(other, 'r', 64);
+    for (int i = 0; i < 64; i++)
+    {
+        my_assert(live[i] == 'q');
+    }
+
+    // The aligned and batch entry points treat zero bytes the same way
+    void *aligned = mem_alloc_aligned(0, 64);
+    my_assert(aligned != NULL);
+    void *batch[2];
+    my_assert(mem_alloc_batch(2, 0, batch) == 2 && batch[0] != NULL && batch[1] != NULL);
+    mem_free_batch(batch, 2);
+    mem_free(aligned);
+    MemStats stats = mem_get_stats();
+    my_assert(stats.bytes_in_use == 128 && stats.failed_allocs == 0);
+
+    // Resizing a zero-size result gives a new block and leaves the live block at that address alone
+    zero = mem_alloc(0);
+    char *same = mem_alloc(64);
+    my_assert(zero == same);
+    memset(same, 's', 64);
+    char *grown = mem_resize(zero, 100);
+    my_assert(grown != NULL && grown != same);
+    my_assert(grown[0] == 's' && grown[63] == 's');
+    for (int i = 0; i < 64; i++)
+    {
+        my_assert(same[i] == 's');
+    }
+    mem_free(grown);
+    mem_free(same);
+
+    mem_free(live);
+    mem_free(other);
+    my_assert(mem_alloc(1024) != NULL);
+    mem_deinit();
+    printf_green("[PASS].\n");
+}
+
+void test_resize_to_zero()
+{
+    printf_yellow("  Testing mem_resize to zero bytes ---> ");
+    MemOptions options = {0};
+    MemPlacement placements[] = {MEM_PLACEMENT_SIZE_CLASSES, MEM_PLACEMENT_BUDDY};
+    for (int p = 0; p < 2; p++)
+    {
+        // A block shrunk to nothing keeps its address to itself until it is freed
+        options.placement = placements[p];
+        mem_init_with_options(4096, &options);
+        char *block = mem_alloc(1000);
+        my_assert(block != NULL);
+        my_assert(mem_resize(block, 0) == block);
+        char *next = mem_alloc(64);
+        my_assert(next != NULL && next != block);
+        mem_free(block);
+        mem_free(next);
+        my_assert(mem_get_stats().bytes_in_use == 0);
+        my_assert(mem_get_stats().buddy_slack == 0);
+        my_assert(mem_alloc(4096) != NULL);
+        mem_deinit();
+    }
+    printf_green("[PASS].\n");
+}
+
+void test_cached_descriptor_growth()
+{
+    printf_yellow("  Testing more than MAX_BLOCKS blocks beside the thread caches ---> ");
+    // Blocks large enough to be carved from the pool itself rather than a thread cache
+    const int nBlocks = MAX_BLOCKS + MAX_BLOCKS / 2;
+    const int blockSize = 320;
+    mem_init(nBlocks * blockSize);
+    void **blocks = malloc(nBlocks * sizeof(void *));
+    my_assert(blocks != NULL);
+
+    // Small blocks go through the thread cache; once flushed, their spans are pool blocks again
+    for (int k = 0; k < 1000; k++)
+    {
+        blocks[k] = mem_alloc(16);
+        my_assert(blocks[k] != NULL);
+    }
+    for (int k = 0; k < 1000; k++)
+    {
+        mem_free(blocks[k]);
+    }
+    mem_flush_cache();
+
+    for (int k = 0; k < nBlocks; k++)
+    {
+        blocks[k] = mem_alloc(blockSize);
+        my_assert(blocks[k] != NULL);
+    }
+    // Recycle descriptors through merges and splits
+    for (int k = 0; k < nBlocks; k += 2)
+    {
+        mem_free(blocks[k]);
+    }
+    for (int k = 0; k < nBlocks; k += 2)
+    {
+        blocks[k] = mem_alloc(blockSize);
+        my_assert(blocks[k] != NULL);
+    }
+    for (int k = 0; k < nBlocks; k++)
+    {
+        mem_free(blocks[k]);
+    }
+    void *whole = mem_alloc(nBlocks * blockSize);
+    my_assert(whole != NULL);
+
+    mem_free(whole);
+    free(blocks);
+    mem_deinit();
+    printf_green("[PASS].\n");
+}
+
+void test_alloc_after_deinit()
+{
+    printf_yellow("  Testing allocation after mem_deinit ---> ");
+    mem_init(1024);
+    void *block = mem_alloc(300);
+    my_assert(block != NULL);
+    mem_deinit();
+
+    // Without a pool every entry point fails instead of searching forever
+    my_assert(mem_alloc(300) == NULL);
+    my_assert(mem_alloc_aligned(300, 64) == NULL);
+    void *blocks[4];
+    my_assert(mem_alloc_batch(4, 300, blocks) == 0);
+    my_assert(blocks[0] == NULL && blocks[3] == NULL);
+    my_assert(mem_handle_alloc(300) == NULL);
+
+    // The pool works again after a new mem_init
+    mem_init(1024);
+    block = mem_alloc(300);
+    my_assert(block != NULL);
+    mem_free(block);
+    mem_deinit();
+    printf_green("[PASS].\n");
+}
+
 void test_resize()
 {
     printf_yellow("  Testing mem_resize ---> ");
@@ -96,6 +1419,39 @@ void test_resize()
     printf_green("[PASS].\n");
 }
 
+void test_resize_in_place()
+{
+    printf_yellow("  Testing mem_resize in place ---> ");
+    mem_init(1024);
+    char *block1 = mem_alloc(100);
+    char *block2 = mem_alloc(100);
+    my_assert(block1 != NULL && block2 != NULL);
+    memset(block1, 'a', 100);
+    mem_free(block2);
+
+    // Grow into the free block that follows
+    my_assert(mem_resize(block1, 600) == block1);
+    my_assert(block1[99] == 'a');
+
+    // Shrink returns the tail, which is reused by the next allocation
+    my_assert(mem_resize(block1, 48) == block1);
+    my_assert(block1[47] == 'a');
+    char *block3 = mem_alloc(976);
+    my_assert(block3 == block1 + 48);
+
+    // With no free neighbour the block has to move and keep its contents
+    mem_free(block3);
+    block3 = mem_alloc(10);
+    char *moved = mem_resize(block1, 200);
+    my_assert(moved != NULL && moved != block1);
+    my_assert(moved[0] == 'a' && moved[47] == 'a');
+
+    mem_free(moved);
+    mem_free(block3);
+    mem_deinit();
+    printf_green("[PASS].\n");
+}
+
 void test_exceed_single_allocation()
 {
     printf_yellow("  Testing allocation exceeding pool size ---> ");
@@ -362,7 +1718,34 @@ int main(int argc, char *argv[])
 	
 	printf("\nVarious tests: \n");
 	printf(" 17. test_zero_alloc_and_free - Ensure that we can allocate 0 bytes, and it does not fail.\n");
-	printf(" 18. test_random_blocks - Test that we can allocate a random size, and random amounts of blocks [1000,10000]. \n\n");
+	printf(" 18. test_random_blocks - Test that we can allocate a random size, and random amounts of blocks [1000,10000]. \n");
+	printf(" 19. test_size_class_reuse - Test that freed blocks are reused through their size class.\n");
+	printf(" 20. test_free_lookup - Test freeing and resizing among many live blocks.\n");
+	printf(" 21. test_random_coalescing - Test that random alloc/free churn coalesces back into one block.\n");
+	printf(" 22. test_resize_in_place - Test growing and shrinking a block without moving it.\n");
+	printf(" 23. test_descriptor_growth - Test that more than MAX_BLOCKS blocks can be created and recycled.\n");
+	printf(" 24. test_threaded_alloc_free - Test allocating from several threads and freeing across threads.\n");
+	printf(" 25. test_arena_isolation - Test that arenas are independent pools that can be destroyed at once.\n");
+	printf(" 26. test_aligned_alloc - Test default alignment and mem_alloc_aligned, and that padding is reclaimed.\n");
+	printf(" 27. test_mmap_backing - Test pools backed by mmap and by huge pages, with fallback.\n");
+	printf(" 28. test_trim - Test that free pages are returned to the OS by mem_trim and by the trim threshold.\n");
+	printf(" 29. test_pool_growth - Test that the pool grows in regions up to its ceiling.\n");
+	printf(" 30. test_stats - Statistics from mem_get_stats\n");
+	printf(" 31. test_object_pool - Fixed-size object pool\n");
+	printf(" 32. test_batch - Batch allocation and free\n");
+	printf(" 33. test_reset_and_mark - Reset and mark/release\n");
+	printf(" 34. test_span_stacks - Lock-free sharing of empty spans\n");
+	printf(" 35. test_remote_free - Remote-free queues\n");
+	printf(" 36. test_handles_and_compaction - Relocatable handles and compaction\n");
+	printf(" 37. test_placement_policies - Next-fit and best-fit placement\n");
+	printf(" 38. test_tlsf_placement - TLSF placement\n");
+	printf(" 39. test_buddy_placement - Buddy placement\n");
+	printf(" 40. test_free_block_scan - Free block scan past many small blocks\n");
+	printf(" 41. test_granule_spans - Small allocations from granule spans\n");
+	printf(" 42. test_zero_size_free - mem_free of a zero-size result beside a live block\n");
+	printf(" 43. test_resize_to_zero - mem_resize to zero bytes\n");
+	printf(" 44. test_cached_descriptor_growth - Test more than MAX_BLOCKS pool blocks while the thread caches are enabled.\n");
+	printf(" 45. test_alloc_after_deinit - Test that allocating without a pool fails instead of hanging.\n\n");
         printf(" 0. Run all tests\n");
         return 1;
     }
@@ -399,6 +1782,33 @@ int main(int argc, char *argv[])
         printf("\nVarious other tests:\n");
         test_zero_alloc_and_free();
         test_random_blocks();
+        test_size_class_reuse();
+        test_free_lookup();
+        test_random_coalescing();
+        test_resize_in_place();
+        test_descriptor_growth();
+        test_threaded_alloc_free();
+        test_arena_isolation();
+        test_aligned_alloc();
+        test_mmap_backing();
+        test_trim();
+        test_pool_growth();
+        test_stats();
+        test_object_pool();
+        test_batch();
+        test_reset_and_mark();
+        test_span_stacks();
+        test_remote_free();
+        test_handles_and_compaction();
+        test_placement_policies();
+        test_tlsf_placement();
+        test_buddy_placement();
+        test_free_block_scan();
+        test_granule_spans();
+        test_zero_size_free();
+        test_resize_to_zero();
+        test_cached_descriptor_growth();
+        test_alloc_after_deinit();
         break;
     case 1:
         test_init();
@@ -454,6 +1864,87 @@ int main(int argc, char *argv[])
     case 18:
         test_random_blocks();
         break;
+    case 19:
+        test_size_class_reuse();
+        break;
+    case 20:
+        test_free_lookup();
+        break;
+    case 21:
+        test_random_coalescing();
+        break;
+    case 22:
+        test_resize_in_place();
+        break;
+    case 23:
+        test_descriptor_growth();
+        break;
+    case 24:
+        test_threaded_alloc_free();
+        break;
+    case 25:
+        test_arena_isolation();
+        break;
+    case 26:
+        test_aligned_alloc();
+        break;
+    case 27:
+        test_mmap_backing();
+        break;
+    case 28:
+        test_trim();
+        break;
+    case 29:
+        test_pool_growth();
+        break;
+    case 30:
+        test_stats();
+        break;
+    case 31:
+        test_object_pool();
+        break;
+    case 32:
+        test_batch();
+        break;
+    case 33:
+        test_reset_and_mark();
+        break;
+    case 34:
+        test_span_stacks();
+        break;
+    case 35:
+        test_remote_free();
+        break;
+    case 36:
+        test_handles_and_compaction();
+        break;
+    case 37:
+        test_placement_policies();
+        break;
+    case 38:
+        test_tlsf_placement();
+        break;
+    case 39:
+        test_buddy_placement();
+        break;
+    case 40:
+        test_free_block_scan();
+        break;
+    case 41:
+        test_granule_spans();
+        break;
+    case 42:
+        test_zero_size_free();
+        break;
+    case 43:
+        test_resize_to_zero();
+        break;
+    case 44:
+        test_cached_descriptor_growth();
+        break;
+    case 45:
+        test_alloc_after_deinit();
+        break;
     default:
         printf("Invalid test function\n");
         break;